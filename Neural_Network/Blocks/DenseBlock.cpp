@@ -9,20 +9,109 @@ DenseBlock::DenseBlock(const int& n_inputs, const int& n_neurons) : m_weights(n_
 	for (size_t i = 0; i < n_neurons; i++)
 		for (size_t j = 0; j < n_inputs + 1; j++)
 			m_weights(j, i) = random(-limit, limit);
-}
 
-void DenseBlock::forward(const Matrix& inputs, ActivationType activation) {
+	packWeights();
+}
 
-	// Y = X * W
-	MATRIX_OPERATION::compute_Y_from_input(m_Y, inputs, m_weights);
+void DenseBlock::forward(ConstMatrixView inputs, ActivationType activation) {
 
-	// Z = a(Y)
-	switch (activation) {
-	case ActivationType::ReLU:
-		m_Z = ACTIVATION::ReLU_activation(m_Y);
+	// Z = a(X * W): bias and ReLU are fused into the GEMM epilogue, softmax runs in place right after.
+	// Y itself is never stored, backprop reads ReLU'(Y) off Z. Mostly-zero inputs skip the GEMM for a sparse product.
+	// The reference and BLAS backends keep the plain product, so A/B runs compare the dense kernels.
+	const bool relu = activation == ActivationType::ReLU;
+	const BACKEND::Backend<real>& backend = BACKEND::get<real>();
+	switch (m_format) {
+	case WeightFormat::Full:
+		if (backend.kind == BACKEND::Kind::Optimized && MATRIX_OPERATION::prefer_sparse(inputs)) {
+			MATRIX_OPERATION::compute_Y_from_sparse_input(m_Z, inputs, m_weights, relu);
+			break;
+		}
+		if (!backend.gemm_packed) {
+			MATRIX_OPERATION::compute_Y_from_input(m_Z, inputs, m_weights, relu);
+			break;
+		}
+		if (m_packed_stale)
+			packWeights();
+		MATRIX_OPERATION::compute_Y_from_input(m_Z, inputs, m_weights, m_packed, relu);
+		break;
+	case WeightFormat::INT8:
+		MATRIX_OPERATION::compute_Y_from_input(m_Z, inputs, m_weights_int8, relu);
+		break;
+	case WeightFormat::Sparse:
+		MATRIX_OPERATION::compute_Y_from_input(m_Z, inputs, m_weights_sparse, relu);
 		break;
-	case ActivationType::Softmax:
-		m_Z = ACTIVATION::softmax_activation(m_Y);
+	default:
+		MATRIX_OPERATION::compute_Y_from_input(m_Z, inputs, m_weights_half, relu);
 		break;
 	}
-};
\ No newline at end of file
+
+	if (activation == ActivationType::Softmax)
+		ACTIVATION::softmax_inplace(m_Z);
+};
+
+// Called once at load, and by the optimizer after every step
+void DenseBlock::packWeights() {
+
+	if (m_format != WeightFormat::Full || !m_packed_stale)
+		return;
+	m_packed.pack(m_weights.rows() - 1, m_weights.cols(), m_weights.data(), m_weights.cols());
+	m_packed_stale = false;
+}
+
+// bf16 / fp16 / int8 / block-sparse storage is for inference: the full-precision weights are released, and widened back on request.
+void DenseBlock::setWeightFormat(WeightFormat format) {
+
+	assert(format != WeightFormat::INT8 && "int8 weights need calibration, use quantize()");
+	assert(format != WeightFormat::Sparse && "block-sparse weights come from pruning, use sparsify()");
+	if (format == m_format)
+		return;
+
+	m_weights = fullWeights();
+	m_weights_half = HalfMatrix();
+	m_weights_int8 = QuantizedMatrix();
+	m_weights_sparse = SparseMatrix();
+
+	if (format != WeightFormat::Full) {
+		m_weights_half = HalfMatrix(m_weights, format);
+		m_weights = Matrix();
+		m_packed.clear();
+	}
+	m_format = format;
+	m_packed_stale = true;
+	packWeights();
+}
+
+// input_max: largest input value seen by this layer on the calibration batches
+void DenseBlock::quantize(float input_max) {
+
+	m_weights = fullWeights();
+	m_weights_half = HalfMatrix();
+	m_weights_sparse = SparseMatrix();
+
+	m_weights_int8 = QuantizedMatrix(m_weights, input_max);
+	m_weights = Matrix();
+	m_packed.clear();
+	m_format = WeightFormat::INT8;
+}
+
+// Keeps only the blocks of the (pruned) weights that hold a non-zero
+void DenseBlock::sparsify() {
+
+	m_weights = fullWeights();
+	m_weights_half = HalfMatrix();
+	m_weights_int8 = QuantizedMatrix();
+
+	m_weights_sparse = SparseMatrix(m_weights);
+	m_weights = Matrix();
+	m_packed.clear();
+	m_format = WeightFormat::Sparse;
+}
+
+Matrix DenseBlock::fullWeights() const {
+	switch (m_format) {
+	case WeightFormat::Full: return m_weights;
+	case WeightFormat::INT8: return m_weights_int8.dequantize<real>();
+	case WeightFormat::Sparse: return m_weights_sparse.densify();
+	default: return m_weights_half.widen<real>();
+	}
+}
@@ -3,30 +3,42 @@
 #ifndef DB_HPP
 #define DB_HPP
 
-enum class ActivationType { ReLU, Softmax };
+enum class ActivationType { ReLU, Softmax, Linear }; // Linear leaves the logits for the fused softmax + cross-entropy
 
 
 // ======== DENSEBLOCK ======== //
 class DenseBlock {
 private:
 	Matrix m_weights;
-	Matrix m_Y;
+	HalfMatrix m_weights_half;
+	QuantizedMatrix m_weights_int8;
+	SparseMatrix m_weights_sparse;
+	WeightFormat m_format = WeightFormat::Full;
 	Matrix m_Z;
-	
-	Matrix ReLU_activation(const Matrix& inputs);
-	Matrix softmax_activation(const Matrix& inputs);
+
+	// Full-precision weights (bias row excluded) packed in GEMM panels, so forward never repacks them.
+	// Any non-const access to the weights marks it stale; it is rebuilt by packWeights() or the next forward.
+	GEMM::PackedB<real> m_packed;
+	bool m_packed_stale = true;
 
 public:
-	DenseBlock() : m_weights(), m_Y(), m_Z() {};
+	DenseBlock() : m_weights(), m_Z() {};
 	DenseBlock(const int& n_inputs, const int& n_neurons);
-	void forward(const Matrix& inputs, ActivationType activation = ActivationType::ReLU);
+	void forward(ConstMatrixView inputs, ActivationType activation = ActivationType::ReLU);
 
-	inline void setWeights(const Matrix& weights) { m_weights = weights; };
+	inline void setWeights(const Matrix& weights) { m_weights = weights; m_weights_half = HalfMatrix(); m_weights_int8 = QuantizedMatrix(); m_weights_sparse = SparseMatrix(); m_format = WeightFormat::Full; m_packed_stale = true; packWeights(); };
+	void packWeights();
+	void setWeightFormat(WeightFormat format);
+	void quantize(float input_max);
+	void sparsify();
+	Matrix fullWeights() const;
+	inline WeightFormat weightFormat() const { return m_format; };
 
-	inline Matrix& weights() { return m_weights; };
+	inline Matrix& weights() { m_packed_stale = true; return m_weights; };
 	inline const Matrix& weights() const { return m_weights; };
-	inline Matrix& preactivation() { return m_Y; };
+	inline const SparseMatrix& sparseWeights() const { return m_weights_sparse; };
 	inline Matrix& output() { return m_Z; };
+	inline const Matrix& output() const { return m_Z; };
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "DataParallel.hpp"
+
+
+// ======== DATA PARALLEL ======== //
+DataParallel::DataParallel(FFNN& model, const hyperparameters& hyper, int n_replicas) : _hyper(hyper), _model(model) {
+
+	for (int r = 1; r < n_replicas; r++) {
+		_replicas.push_back(std::make_unique<FFNN>(hyper));
+		_replicas.back()->copyLayers(model);
+	}
+	m_stats.resize(size());
+	m_params.resize(size());
+
+	const auto& params = model.getParameters();
+	for (size_t p = 0; p < params.size(); p++) {
+		const size_t n = params[p].first->rows() * params[p].first->cols();
+		for (size_t begin = 0; begin < n; begin += chunk)
+			m_chunks.push_back({ p, begin, std::min(begin + chunk, n) });
+	}
+}
+
+LossStats DataParallel::step(ConstMatrixView input, const int* labels, Scope& scope) {
+
+	// Shards of consecutive rows; no more replicas than rows
+	const size_t rows = input.rows();
+	const size_t n_shards = std::max<size_t>(std::min(size(), rows), 1);
+	THREADS::parallel_for(n_shards, [&](size_t s) {
+		const size_t first = rows * s / n_shards;
+		const size_t count = rows * (s + 1) / n_shards - first;
+		FFNN& model = replica(s);
+		ConstMatrixView shard = input.rows(first, count);
+		model.forward(shard, true);
+		m_stats[s] = model.backpropagation(shard, labels + first);
+	});
+
+	LossStats stats;
+	for (size_t s = 0; s < n_shards; s++) {
+		const size_t count = rows * (s + 1) / n_shards - rows * s / n_shards;
+		stats.loss += m_stats[s].loss * count;
+		stats.correct += m_stats[s].correct;
+	}
+	if (rows)
+		stats.loss /= rows;
+
+	all_reduce(n_shards);
+	scope.step(_model);
+	broadcast();
+
+	return stats;
+}
+
+// Pairwise tree over the shards: dW[r] += dW[r + stride] for stride = 1, 2, 4... Same order for every chunk.
+void DataParallel::all_reduce(size_t n_shards) {
+	if (n_shards == 1)
+		return;
+
+	for (size_t r = 0; r < n_shards; r++)
+		m_params[r] = &replica(r).getParameters();
+
+	const BACKEND::Backend<real>& backend = BACKEND::get<real>();
+	THREADS::parallel_for(m_chunks.size(), [&](size_t c) {
+		const Chunk& range = m_chunks[c];
+		for (size_t stride = 1; stride < n_shards; stride *= 2)
+			for (size_t r = 0; r + stride < n_shards; r += 2 * stride) {
+				const real* from = (*m_params[r + stride])[range.parameter].second->data();
+				real* into = (*m_params[r])[range.parameter].second->data();
+				backend.axpy(range.end - range.begin, real(1), from + range.begin, into + range.begin);
+			}
+	});
+}
+
+// The updated weights, from the model to every replica
+void DataParallel::broadcast() {
+	if (_replicas.empty())
+		return;
+
+	// getParameters() goes through the non-const weights(), which marks the replicas' packed weights stale
+	for (size_t r = 0; r < size(); r++)
+		m_params[r] = &replica(r).getParameters();
+
+	const size_t n_chunks = m_chunks.size();
+	THREADS::parallel_for(n_chunks * _replicas.size(), [&](size_t task) {
+		const Chunk& range = m_chunks[task % n_chunks];
+		const real* from = (*m_params[0])[range.parameter].first->data();
+		real* into = (*m_params[1 + task / n_chunks])[range.parameter].first->data();
+		std::copy(from + range.begin, from + range.end, into + range.begin);
+	});
+}
@@ -0,0 +1,46 @@
+#include <memory>
+
+#include "..\Classifier/Scope.hpp"
+
+
+#ifndef DATA_PARALLEL_HPP
+#define DATA_PARALLEL_HPP
+
+
+// ======== DATA PARALLEL ======== //
+// Synchronous data-parallel training step: the batch is cut into row shards, one per replica of the model,
+// each replica runs forward + backprop on its shard on its own pool thread, the replicas' dW are summed
+// into the model's (tree all-reduce), the Scope steps the model once and its weights are copied back to
+// the replicas. dZ isn't averaged over the batch, so the summed dW is the full-batch dW up to the order of
+// the additions. Replica 0 is the model itself.
+class DataParallel {
+private:
+	const hyperparameters& _hyper;
+	FFNN& _model;
+	std::vector<std::unique_ptr<FFNN>> _replicas;
+
+	// The parameters are reduced in chunks of this many values, each one down the whole tree while it sits in L2
+	static constexpr size_t chunk = size_t(1) << 14;
+	struct Chunk {
+		size_t parameter;
+		size_t begin;
+		size_t end;
+	};
+	std::vector<Chunk> m_chunks;
+	std::vector<LossStats> m_stats;
+	std::vector<const std::vector<std::pair<Matrix*, Matrix*>>*> m_params; // getParameters() of every replica
+
+	inline FFNN& replica(size_t r) { return r == 0 ? _model : *_replicas[r - 1]; };
+	void all_reduce(size_t n_shards);
+	void broadcast();
+
+public:
+	DataParallel(FFNN& model, const hyperparameters& hyper, int n_replicas);
+
+	inline size_t size() const { return _replicas.size() + 1; };
+
+	// One update of the model on the whole batch. Returns its mean loss and number of correct predictions.
+	LossStats step(ConstMatrixView input, const int* labels, Scope& scope);
+};
+
+#endif
@@ -0,0 +1,62 @@
+#include "Hogwild.hpp"
+
+
+// ======== HOGWILD ======== //
+Hogwild::Hogwild(FFNN& model, const hyperparameters& hyper, Scope& scope) : _hyper(hyper), _model(model), _scope(scope) {
+
+	const size_t n_workers = THREADS::threads();
+	for (size_t w = 0; w < n_workers; w++) {
+		_replicas.push_back(std::make_unique<FFNN>(hyper));
+		_replicas.back()->copyLayers(model);
+		if (w > 0 && hyper.hogwild == HogwildMoments::PerThread)
+			_scopes.push_back(std::make_unique<Scope>(scope));
+	}
+	m_stats.resize(n_workers);
+}
+
+// Copy of the shared weights into the replica, while the other workers may be updating them
+void Hogwild::pull(FFNN& replica) {
+
+	const auto& params = replica.getParameters();
+	for (size_t k = 0; k < params.size(); k++) {
+		const Matrix& shared = *m_weights[k];
+		std::copy(shared.data(), shared.data() + shared.rows() * shared.cols(), params[k].first->data());
+	}
+}
+
+LossStats Hogwild::epoch(const Dataset& data, size_t n_batches) {
+
+	// getParameters() marks the model's packed weights stale, they're packed again at the end
+	m_weights.clear();
+	for (auto& [W, dW] : _model.getParameters())
+		m_weights.push_back(W);
+
+	std::atomic<size_t> next{ 0 };
+	THREADS::parallel_for(size(), [&](size_t w) {
+		FFNN& replica = *_replicas[w];
+		Scope& worker_scope = scope(w);
+		LossStats& stats = m_stats[w];
+		stats = LossStats();
+
+		for (size_t n = next.fetch_add(1); n < n_batches; n = next.fetch_add(1)) {
+			pull(replica);
+			replica.forward(data.x(n), true);
+			const LossStats batch = replica.backpropagation(data.x(n), data.y(n));
+			stats.loss += batch.loss;
+			stats.correct += batch.correct;
+
+			const auto& params = replica.getParameters();
+			for (size_t k = 0; k < params.size(); k++)
+				worker_scope.LazyAdam(*m_weights[k], *params[k].second, static_cast<int>(k));
+			worker_scope.tick();
+		}
+	});
+	_model.packWeights();
+
+	LossStats total;
+	for (const LossStats& stats : m_stats) {
+		total.loss += stats.loss;
+		total.correct += stats.correct;
+	}
+	return total;
+}
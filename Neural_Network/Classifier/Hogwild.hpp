@@ -0,0 +1,42 @@
+#include <memory>
+
+#include "..\Classifier/Scope.hpp"
+#include "..\Dataset/Dataset.hpp"
+
+
+#ifndef HOGWILD_HPP
+#define HOGWILD_HPP
+
+
+// ======== HOGWILD ======== //
+// Asynchronous lock-free training: every pool thread pulls mini-batches off a shared counter, runs forward +
+// backprop on its own replica of the model, and applies its Adam update straight to the model's weights.
+// There are no locks: the replicas copy the weights while other threads write them, and concurrent updates
+// may overwrite each other. The order of the updates changes from run to run, so the results aren't reproducible.
+// The update is Scope::LazyAdam: with sparse inputs, the workers mostly write disjoint rows of the first layer.
+// The moments are either one per thread (copies of the Scope, which keeps its own) or the Scope's, shared.
+class Hogwild {
+private:
+	const hyperparameters& _hyper;
+	FFNN& _model;
+	Scope& _scope;
+	std::vector<std::unique_ptr<FFNN>> _replicas; // One per pool thread
+	std::vector<std::unique_ptr<Scope>> _scopes; // Per-thread moments of threads 1...; thread 0 uses the Scope's
+
+	std::vector<Matrix*> m_weights; // The model's trained weights, shared by the workers
+	std::vector<LossStats> m_stats;
+
+	inline Scope& scope(size_t w) { return (w == 0 || _scopes.empty()) ? _scope : *_scopes[w - 1]; };
+	void pull(FFNN& replica);
+
+public:
+	Hogwild(FFNN& model, const hyperparameters& hyper, Scope& scope);
+
+	inline size_t size() const { return _replicas.size(); };
+
+	// The first n_batches mini-batches of data, once each, in no particular order.
+	// Returns the sum of their mean losses and their number of correct predictions.
+	LossStats epoch(const Dataset& data, size_t n_batches);
+};
+
+#endif
@@ -0,0 +1,92 @@
+#include "Pipeline.hpp"
+
+
+// ======== PIPELINE ======== //
+Pipeline::Pipeline(FFNN& model, Scope& scope) : _model(model), _scope(scope) {
+
+	_n_params = static_cast<int>(model.getParameters().size());
+	m_pending.assign(_n_params, 0);
+	_helper = std::thread(&Pipeline::work, this);
+}
+
+Pipeline::~Pipeline() {
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_posted.notify_one();
+	_helper.join();
+}
+
+// The helper leaves the pool to the calling thread: its updates are small and run while the pool does backprop's GEMMs
+void Pipeline::work() {
+
+	THREADS::serial_thread();
+	while (true) {
+		Update update;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_posted.wait(lock, [&]() { return _stop || !_queue.empty(); });
+			if (_queue.empty())
+				return;
+			update = _queue.front();
+			_queue.pop_front();
+		}
+
+		auto [W, dW] = _model.getParameters(update.layer);
+		_scope.Adam(*W, *dW, update.layer, update.step);
+		_model.packWeights(update.layer);
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			m_pending[update.layer] = 0;
+		}
+		_updated.notify_all();
+	}
+}
+
+void Pipeline::post(int l) {
+
+	if (l == 0 || l >= _n_params)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		m_pending[l] = 1;
+		_queue.push_back({ l, _scope.steps() });
+	}
+	_posted.notify_one();
+}
+
+void Pipeline::wait(int l) {
+
+	if (l >= _n_params)
+		return;
+	std::unique_lock<std::mutex> lock(_mutex);
+	_updated.wait(lock, [&]() { return !m_pending[l]; });
+}
+
+LossStats Pipeline::step(ConstMatrixView input, const int* labels) {
+
+	const LayerHook before_layer = { [](void* self, int l) { static_cast<Pipeline*>(self)->wait(l); }, this };
+	const LayerHook layer_done = { [](void* self, int l) { static_cast<Pipeline*>(self)->post(l); }, this };
+
+	_model.forward(input, true, before_layer);
+	const LossStats stats = _model.backpropagation(input, labels, layer_done);
+
+	// First layer: nothing left to overlap it with, the next forward needs it first
+	if (_n_params > 0) {
+		auto [W, dW] = _model.getParameters(0);
+		_scope.Adam(*W, *dW, 0);
+		_model.packWeights(0);
+	}
+	_scope.tick();
+
+	return stats;
+}
+
+void Pipeline::sync() {
+
+	for (int l = 1; l < _n_params; l++)
+		wait(l);
+}
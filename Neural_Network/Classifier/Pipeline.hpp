@@ -0,0 +1,52 @@
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "..\Classifier/Scope.hpp"
+
+
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+
+// ======== PIPELINE ======== //
+// Training step with a layer-wise pipelined schedule. As soon as backprop is done with a layer (dW computed,
+// weights used for dZ of the layer below), its Adam update and packing go to a helper thread and run during
+// the rest of backprop. The first layer's gradient comes last and the next forward starts with it, so its
+// update (the biggest) runs right away on the calling thread, with the pool. The next forward only waits for
+// a layer's update right before that layer. Same updates as Scope::step, same results.
+class Pipeline {
+private:
+	FFNN& _model;
+	Scope& _scope;
+	int _n_params; // Trained layers, as in FFNN::getParameters()
+
+	struct Update {
+		int layer;
+		int step; // The Scope's step count when posted, the Scope moves on before the helper is done
+	};
+	std::thread _helper;
+	std::mutex _mutex;
+	std::condition_variable _posted;
+	std::condition_variable _updated;
+	std::deque<Update> _queue;
+	std::vector<char> m_pending; // Layers with an update posted and not done yet
+	bool _stop = false;
+
+	void work();
+	void post(int l);
+	void wait(int l);
+
+public:
+	Pipeline(FFNN& model, Scope& scope);
+	~Pipeline();
+
+	// One update of the model on the batch. Returns its mean loss and number of correct predictions.
+	LossStats step(ConstMatrixView input, const int* labels);
+
+	// Waits for every posted update: call before reading the model's weights elsewhere
+	void sync();
+};
+
+#endif
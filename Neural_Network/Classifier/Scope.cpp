@@ -12,24 +12,72 @@ Scope::Scope(FFNN& model, const hyperparameters& hyper) : _hyper(hyper), t(1) {
 	}
 }
 
+Scope::Scope(const Scope& other) : _hyper(other._hyper), M(other.M), V(other.V), masks(other.masks), t(other.t.load()) {}
+
+BACKEND::AdamStep<real> Scope::adam_step(int step) const {
+
+	const real beta_1 = 0.9;
+	const real beta_2 = 0.999;
+
+	BACKEND::AdamStep<real> adam_step;
+	adam_step.beta_1 = beta_1;
+	adam_step.beta_2 = beta_2;
+	adam_step.learning_rate = _hyper.learning_rate;
+	adam_step.bias_1_correction = 1 - std::pow(beta_1, step);
+	adam_step.bias_2_correction = 1 - std::pow(beta_2, step);
+	adam_step.epsilon = real(1e-8);
+	return adam_step;
+}
+
 void Scope::Adam(Matrix& W, Matrix& dW, const int k) {
 
-	const double beta_1 = 0.9;
-	const double beta_2 = 0.999;
+	Adam(W, dW, k, t);
+}
+
+void Scope::Adam(Matrix& W, Matrix& dW, const int k, const int step) {
 
-	M[k] = M[k] * beta_1 + dW * (1 - beta_1);
-	V[k] = V[k] * beta_2 + dW.hadamard(dW) * (1 - beta_2);
+	const BACKEND::Backend<real>& backend = BACKEND::get<real>();
+	const size_t n = W.rows() * W.cols();
+	backend.adam(n, W.data(), dW.data(), M[k].data(), V[k].data(), adam_step(step));
 
-	double bias_1_correction = 1.0 - std::pow(beta_1, t);
-	double bias_2_correction = 1.0 - std::pow(beta_2, t);
+	// Pruned weights stay at zero while fine-tuning
+	if (!masks.empty())
+		backend.hadamard(n, masks[k].data(), W.data());
+}
+
+// Adam on the rows of W whose gradient isn't all zero, the others (and their moments) are left as they are.
+// With sparse inputs, most rows of the first layer are skipped: fewer writes, and fewer collisions between Hogwild workers.
+void Scope::LazyAdam(Matrix& W, Matrix& dW, const int k) {
 
+	const BACKEND::Backend<real>& backend = BACKEND::get<real>();
+	const BACKEND::AdamStep<real> step = adam_step(t);
+	const size_t cols = W.cols();
 	for (size_t i = 0; i < W.rows(); i++) {
-		for (size_t j = 0; j < W.cols(); j++) {
-			double M_hat = M[k](i, j) / bias_1_correction;
-			double V_hat = V[k](i, j) / bias_2_correction;
-			W(i, j) -= (M_hat / (sqrt(V_hat) + 1e-8)) * _hyper.learning_rate;
-		}
+		const size_t row = i * cols;
+		const real* gradient = dW.data() + row;
+		if (std::all_of(gradient, gradient + cols, [](real g) { return g == 0; }))
+			continue;
+
+		backend.adam(cols, W.data() + row, gradient, M[k].data() + row, V[k].data() + row, step);
+		if (!masks.empty())
+			backend.hadamard(cols, masks[k].data() + row, W.data() + row);
+	}
+}
+
+// Magnitude pruning of every trained layer to the given fraction of zero blocks (see PRUNING::magnitude_mask_into).
+// The masks are kept and applied after every update, so training on fine-tunes the remaining weights.
+void Scope::prune(FFNN& model, double sparsity) {
+
+	int k = 0;
+	masks.resize(M.size());
+	for (auto& [W, dW] : model.getParameters()) {
+		PRUNING::magnitude_mask_into(masks[k], *W, sparsity);
+		*W = W->hadamard(masks[k]);
+		M[k] = M[k].hadamard(masks[k]);
+		V[k] = V[k].hadamard(masks[k]);
+		k++;
 	}
+	model.packWeights();
 }
 
 void Scope::SGD(Matrix& W, Matrix& dW) {
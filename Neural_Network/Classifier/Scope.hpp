@@ -1,3 +1,5 @@
+#include <atomic>
+
 #include "..\FFNN/FFNN.hpp"
 
 #ifndef SCOPE_HPP
@@ -10,25 +12,36 @@ private:
 	const hyperparameters& _hyper;
 
 	std::vector<Matrix> M, V;
+	std::vector<Matrix> masks; // Pruning masks (1 = kept), empty until prune() is called
+
+	std::atomic<int> t; // Atomic for the Hogwild workers sharing one Scope
 
-	int t;
+	BACKEND::AdamStep<real> adam_step(int step) const;
 
 public:
 	Scope(FFNN&, const hyperparameters&);
+	Scope(const Scope&); // Moments, masks and step count, for Hogwild's per-thread moments
 
 	void Adam(Matrix& W, Matrix& dW, const int k);
+	void Adam(Matrix& W, Matrix& dW, const int k, const int step); // Bias corrections of the given step (see Pipeline)
+	void LazyAdam(Matrix& W, Matrix& dW, const int k);
 	void SGD(Matrix& W, Matrix& dW);
+	void prune(FFNN& model, double sparsity);
 
 	inline void step(FFNN& model) {
 
 		int k = 0;
 		for (auto& [W, dW] : model.getParameters())
 			Adam(*W, *dW, k++);
+		model.packWeights();
 
 		t++;
 
 	};
 
+	inline void tick() { t++; };
+	inline int steps() const { return t; };
+
 };
 
 #endif
\ No newline at end of file
@@ -1,13 +1,14 @@
 #include "TrainerClassifier.hpp"
 
+#include <chrono>
+#include <future>
+
 
 // ======== TRAINER CLASSIFIER ======== //
 TrainerClassifier::TrainerClassifier(FFNN& model, const hyperparameters& hyper) : _model(model), _hyper(hyper) {
 	_scope = nullptr;
-	_xtrain = nullptr;
-	_ytrain = nullptr;
-	_xvalid = nullptr;
-	_yvalid = nullptr;
+	_train = nullptr;
+	_valid = nullptr;
 }
 
 void TrainerClassifier::set_scope(Scope& scope) {
@@ -15,11 +16,24 @@ void TrainerClassifier::set_scope(Scope& scope) {
 }
 
 void TrainerClassifier::set_data(Dataset& train, Dataset& validation) {
-	_xtrain = &train.x;
-	_ytrain = &train.y;
+	_train = &train;
+	_valid = &validation;
+}
 
-	_xvalid = &validation.x;
-	_yvalid = &validation.y;
+// Accuracy (%) of a model on a whole dataset. The batches are large (Dataset::eval_batch_size), so the forward's
+// GEMMs and sparse products split them between the pool threads; the argmax is counted without a one-hot copy.
+static double accuracy(FFNN& model, const Dataset& data) {
+
+	int correct = 0;
+	size_t n_samples = 0;
+	for (size_t n = 0; n < data.n_batches; n++) {
+		ConstMatrixView X = data.x(n);
+		model.forward(X, false);
+		correct += LOSS::count_correct(model.getOutput(), data.y(n));
+		n_samples += X.rows();
+	}
+
+	return n_samples ? 100.0 * correct / n_samples : 0.0;
 }
 
 void TrainerClassifier::run(bool store) {
@@ -29,85 +43,221 @@ void TrainerClassifier::run(bool store) {
 	d_vector train_acc_array;
 	d_vector val_acc_array;
 
-	// Early stopping
+	// Early stopping, back to the weights of the lowest-loss epoch (if any beat bestLoss)
 	FFNN best(_hyper);
+	int bestEpoch = -1;
 	int iPatience = 0;
 	double bestLoss = 2;
 	int nb_epochs = _hyper.max_epochs;
 
-	const int n_batches = _hyper.n_train_samples / _hyper.mini_batch_size;
-	for (int epoch = 0; epoch < nb_epochs; epoch++) {
-
-		double epoch_loss = 0;
-		int train_correct = 0;
-		int val_correct = 0;
-
-		// Train accuracy
-		for (int n = 0; n < n_batches; n++) {
-			Matrix& X = (*_xtrain)[n];
-			Matrix& Y = (*_ytrain)[n];
-
-			_model.forward(X, true);
-			_model.backpropagation(X, Y);
-
-			_scope->step(_model);
+	// Each step takes batches_per_step mini-batches, shared between the data-parallel replicas if there are several.
+	// Hogwild workers take one mini-batch at a time.
+	const bool hogwild = _hyper.hogwild != HogwildMoments::Off;
+	const int per_step = hogwild ? 1 : std::max(_hyper.batches_per_step, 1);
+	const int n_steps = static_cast<int>(_train->n_batches) / per_step;
+	const int samples_per_epoch = n_steps * per_step * _hyper.mini_batch_size;
+	std::unique_ptr<DataParallel> parallel;
+	std::unique_ptr<Hogwild> workers;
+	std::unique_ptr<Pipeline> pipeline;
+	if (hogwild)
+		workers = std::make_unique<Hogwild>(_model, _hyper, *_scope);
+	else if (_hyper.n_replicas > 1)
+		parallel = std::make_unique<DataParallel>(_model, _hyper, _hyper.n_replicas);
+	else if (_hyper.pipelined)
+		pipeline = std::make_unique<Pipeline>(_model, *_scope);
 
-			// Loss & accuracy
-			const Matrix& y_pred = _model.getOutput();
-			epoch_loss += CELossFunction(y_pred, Y);
+	// Validation runs on a snapshot of the end-of-epoch weights, on a background thread, while the next epoch trains.
+	// Its results are printed and stored when they arrive, one epoch behind.
+	struct EpochResult {
+		int epoch;
+		double loss;
+		double train_accuracy;
+		double samples_per_second;
+	};
+	FFNN snapshot(_hyper);
+	EpochResult pending = {};
+	std::future<double> validation;
 
-			Matrix y_pred_one_hot = y_pred.setMaxToOne();
-			for (int i = 0; i < Y.rows(); i++)
-				if (Y.row(i) == y_pred_one_hot.row(i))
-					train_correct++;
-		}
-		epoch_loss /= n_batches;
-		double train_accuracy = 100.0 * train_correct / _hyper.n_train_samples;
-
-		// Validation accuracy
-		for (int n = 0; n < _hyper.n_val_samples; n++) {
-			Matrix& X = (*_xvalid)[n];
-			Matrix& Y = (*_yvalid)[n];
-
-			_model.forward(X, false);
-			
-			const Matrix& y_pred = _model.getOutput();
-			Matrix y_pred_one_hot = y_pred.setMaxToOne();
-			if (Y.row(0) == y_pred_one_hot.row(0))
-				val_correct++;
-		}
-		double val_accuracy = 100.0 * val_correct / _hyper.n_val_samples;
+	const auto report = [&](const EpochResult& result, double val_accuracy) {
 
 		// Printing the results
-		print("[Epoch ", epoch+1, "/", _hyper.max_epochs, "] ",
-			  "Loss = ", epoch_loss, " | ",
-			  "train_acc = ", train_accuracy, " % | ",
-			  "val_acc = ", val_accuracy, " %");
+		print("[Epoch ", result.epoch+1, "/", _hyper.max_epochs, "] ",
+			  "Loss = ", result.loss, " | ",
+			  "train_acc = ", result.train_accuracy, " % | ",
+			  "val_acc = ", val_accuracy, " % | ",
+			  result.samples_per_second, " samples/s");
 
 		// Storing data
 		if (store) {
 			// Accuracy
-			train_acc_array.push_back(train_accuracy);
+			train_acc_array.push_back(result.train_accuracy);
 			val_acc_array.push_back(val_accuracy);
 
 			// Loss
-			CELoss.push_back(epoch_loss);
+			CELoss.push_back(result.loss);
+		}
+	};
+	bool stopped = false;
+
+	for (int epoch = 0; epoch < nb_epochs; epoch++) {
+
+		double epoch_loss = 0;
+		int train_correct = 0;
+
+		// Train accuracy
+		const auto start = std::chrono::steady_clock::now();
+		if (workers) {
+			const LossStats stats = workers->epoch(*_train, n_steps);
+			epoch_loss = stats.loss;
+			train_correct = stats.correct;
+		}
+		else for (int n = 0; n < n_steps; n++) {
+			ConstMatrixView X = _train->x(n * per_step, per_step);
+			const int* y = _train->y(n * per_step);
+
+			// Loss & accuracy come out of the fused softmax + cross-entropy backward
+			LossStats stats;
+			if (parallel)
+				stats = parallel->step(X, y, *_scope);
+			else if (pipeline)
+				stats = pipeline->step(X, y);
+			else {
+				_model.forward(X, true);
+				stats = _model.backpropagation(X, y);
+				_scope->step(_model);
+			}
+			epoch_loss += stats.loss;
+			train_correct += stats.correct;
 		}
+		if (pipeline)
+			pipeline->sync();
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		epoch_loss /= n_steps;
+		double train_accuracy = 100.0 * train_correct / samples_per_epoch;
 
-		// Implement early stopping
+		// Implement early stopping. It looks at the training loss, known now: only the report waits for the validation.
 		if (_hyper.early_stopping) {
 			if (epoch_loss < bestLoss) {
 				bestLoss = epoch_loss;
+				bestEpoch = epoch;
+				best.copyLayers(_model);
 				iPatience = 0;
 			} else iPatience++;
 
-			if (iPatience > _hyper.patience) {
-				best.copyLayers(_model);
-				nb_epochs = epoch;
-				print("Breaking"); break;
-			}
+			stopped = iPatience > _hyper.patience;
 		}
+
+		// Previous epoch's validation, then this epoch's weights go to the background thread.
+		// It runs its forwards serially and leaves the pool to training.
+		if (validation.valid())
+			report(pending, validation.get());
+		snapshot.copyLayers(_model);
+		pending = { epoch, epoch_loss, train_accuracy, samples_per_epoch / seconds };
+		validation = std::async(std::launch::async, [&]() {
+			THREADS::serial_thread();
+			return accuracy(snapshot, *_valid);
+		});
+
+		if (stopped) {
+			nb_epochs = epoch;
+			break;
+		}
+	}
+	if (validation.valid())
+		report(pending, validation.get());
+	if (stopped) {
+		if (bestEpoch >= 0)
+			_model.copyLayers(best);
+		print("Breaking, back to the weights of epoch ", bestEpoch + 1);
 	}
 	if(store)
 		writeFile(train_acc_array, val_acc_array, CELoss, nb_epochs, "training_data.csv");
+}
+
+// Accuracy (%) of the current model on a whole dataset
+double TrainerClassifier::evaluate(const Dataset& data) {
+
+	return accuracy(_model, data);
+}
+
+// Training throughput (samples/s) of data-parallel steps with one replica per core, for each core count.
+// Runs on a copy of the model; the pool is set back to its size afterwards.
+void TrainerClassifier::scaling(const Dataset& data, const i_vector& cores, int n_steps) {
+
+	const int per_step = std::max(_hyper.batches_per_step, 1);
+	const int available = static_cast<int>(data.n_batches) / per_step;
+	const size_t threads = THREADS::threads();
+	double base = 0;
+	for (int n_cores : cores) {
+		THREADS::set_threads(n_cores);
+		FFNN replica(_hyper);
+		replica.copyLayers(_model);
+		Scope scope(replica, _hyper);
+		DataParallel parallel(replica, _hyper, n_cores);
+
+		// One warm-up step: first packing, buffers
+		parallel.step(data.x(0, per_step), data.y(0), scope);
+		const auto start = std::chrono::steady_clock::now();
+		for (int n = 0; n < n_steps; n++) {
+			const int b = (n % available) * per_step;
+			parallel.step(data.x(b, per_step), data.y(b), scope);
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		const double samples = double(n_steps) * per_step * data.batch_size / seconds;
+		if (base == 0)
+			base = samples;
+		print(n_cores, " cores: ", samples, " samples/s (x", samples / base, ")");
+	}
+	THREADS::set_threads(threads);
+}
+
+// Convergence against throughput: synchronous data-parallel training (one mini-batch per pool thread and per step,
+// their dW summed by the all-reduce, not averaged: one Adam step on the summed gradient, which Adam's scaling by
+// sqrt(V) makes about as large as a single mini-batch's) and Hogwild with per-thread then shared moments,
+// each from a copy of the model.
+// Prints the loss, validation accuracy, elapsed time and samples/s of every epoch.
+void TrainerClassifier::compare_hogwild(const Dataset& train, const Dataset& validation, int n_epochs) {
+
+	const int n_threads = static_cast<int>(THREADS::threads());
+	const std::pair<HogwildMoments, const char*> modes[] = {
+		{ HogwildMoments::Off, "synchronous" }, { HogwildMoments::PerThread, "hogwild, per-thread moments" }, { HogwildMoments::Shared, "hogwild, shared moments" } };
+	for (auto& [mode, name] : modes) {
+		hyperparameters hyper = _hyper;
+		hyper.hogwild = mode;
+		hyper.n_replicas = n_threads;
+		hyper.batches_per_step = n_threads;
+
+		FFNN model(hyper);
+		model.copyLayers(_model);
+		Scope scope(model, hyper);
+		std::unique_ptr<DataParallel> parallel;
+		std::unique_ptr<Hogwild> workers;
+		if (mode == HogwildMoments::Off)
+			parallel = std::make_unique<DataParallel>(model, hyper, hyper.n_replicas);
+		else
+			workers = std::make_unique<Hogwild>(model, hyper, scope);
+
+		const int per_step = mode == HogwildMoments::Off ? n_threads : 1;
+		const int n_steps = static_cast<int>(train.n_batches) / per_step;
+		const double samples_per_epoch = double(n_steps) * per_step * train.batch_size;
+		double elapsed = 0;
+		for (int epoch = 0; epoch < n_epochs; epoch++) {
+			LossStats stats;
+			const auto start = std::chrono::steady_clock::now();
+			if (mode == HogwildMoments::Off)
+				for (int n = 0; n < n_steps; n++)
+					stats.loss += parallel->step(train.x(n * per_step, per_step), train.y(n * per_step), scope).loss;
+			else
+				stats = workers->epoch(train, n_steps);
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			elapsed += seconds;
+
+			print(name, " [Epoch ", epoch + 1, "/", n_epochs, "] ",
+				  "Loss = ", stats.loss / n_steps, " | ",
+				  "val_acc = ", accuracy(model, validation), " % | ",
+				  elapsed, " s | ",
+				  samples_per_epoch / seconds, " samples/s");
+		}
+	}
 }
\ No newline at end of file
@@ -1,4 +1,7 @@
 #include "..\Classifier/Scope.hpp"
+#include "..\Classifier/DataParallel.hpp"
+#include "..\Classifier/Hogwild.hpp"
+#include "..\Classifier/Pipeline.hpp"
 #include "..\Dataset/Dataset.hpp"
 
 
@@ -13,16 +16,17 @@ private:
 	FFNN& _model;
 
 	Scope* _scope;
-	std::vector<Matrix>* _xtrain;
-	std::vector<Matrix>* _ytrain;
-	std::vector<Matrix>* _xvalid;
-	std::vector<Matrix>* _yvalid;
+	const Dataset* _train;
+	const Dataset* _valid;
 
 public:
 	TrainerClassifier(FFNN&, const hyperparameters&);
 	void set_scope(Scope&);
 	void set_data(Dataset&, Dataset&);
 	void run(bool);
+	double evaluate(const Dataset&);
+	void scaling(const Dataset&, const i_vector& cores, int n_steps);
+	void compare_hogwild(const Dataset& train, const Dataset& validation, int n_epochs);
 };
 
 #endif
\ No newline at end of file
@@ -17,8 +17,9 @@ inline int reverseInt(int i) { // To little-endian
 	c4 = (i >> 24) & 255;
 	return ((int)c1 << 24) + ((int)c2 << 16) + ((int)c3 << 8) + c4;
 }
+// Reads the first max_images images (all if 0) straight into one row per image
 inline void readMNIST(const std::string& imageFile, const std::string& labelFile,
-	d_matrix& images, d_vector& labels) {
+	Matrix& images, i_vector& labels, size_t max_images = 0) {
 	std::ifstream imgFile(imageFile, std::ios::binary);
 	std::ifstream lblFile(labelFile, std::ios::binary);
 
@@ -38,68 +39,71 @@ inline void readMNIST(const std::string& imageFile, const std::string& labelFile
 	lblFile.read(reinterpret_cast<char*>(&numLabels), sizeof(numLabels));
 	numLabels = reverseInt(numLabels);
 
-	int n = std::min(numImages, numLabels);
-	images.resize(n, std::vector<double>(numRows * numCols));
+	size_t n = std::max(0, std::min(numImages, numLabels));
+	if (max_images)
+		n = std::min(n, max_images);
+	images = Matrix(n, numRows * numCols);
 	labels.resize(n);
 
-	for (int i = 0; i < n; ++i) {
-		for (int j = 0; j < numRows * numCols; ++j) {
-			unsigned char pixel;
-			imgFile.read(reinterpret_cast<char*>(&pixel), sizeof(pixel));
-			images[i][j] = static_cast<double>(pixel) / 255.0;
-		}
+	std::vector<unsigned char> pixels(numRows * numCols);
+	for (size_t i = 0; i < n; ++i) {
+		imgFile.read(reinterpret_cast<char*>(pixels.data()), pixels.size());
+		for (size_t j = 0; j < pixels.size(); ++j)
+			images(i, j) = static_cast<real>(pixels[j]) / real(255);
 		unsigned char label;
 		lblFile.read(reinterpret_cast<char*>(&label), sizeof(label));
-		labels[i] = static_cast<double>(label);
+		labels[i] = static_cast<int>(label);
 	}
 }
 
 
 // ======== DATASET ======== //
+// All images in one matrix, one row each. Batches are views over consecutive rows, never copies.
+// The last batch may be shorter (validation and test sets), x() stops at the last image.
 struct Dataset {
-	std::vector<Matrix> x;
-	std::vector<Matrix> y;
+	Matrix images;
+	i_vector labels; // Integer labels, no one-hot
+	size_t batch_size = 1;
+	size_t n_batches = 0;
+
+	// Validation and test batches: large GEMMs, split between the pool threads, instead of one GEMV per image
+	static constexpr size_t eval_batch_size = 500;
+
+	inline ConstMatrixView x(size_t n, size_t count = 1) const { return images.view().rows(n * batch_size, std::min(count * batch_size, images.rows() - n * batch_size)); };
+	inline const int* y(size_t n) const { return labels.data() + n * batch_size; };
 };
 inline Dataset DataLoader(const hyperparameters& hyper, const std::string& dataset_type) {
 
-	int n_iter = 0;
-	int batch_size = 0;
-	d_matrix images;
-	d_vector labels;
+	Dataset data;
 	std::string ImagesFile;
 	std::string LabelsFile;
+	size_t n_samples = 0; // 0: the whole file
 	if (dataset_type == "train") {
 		ImagesFile = "executable/database/MNIST/train-images.idx3-ubyte";
 		LabelsFile = "executable/database/MNIST/train-labels.idx1-ubyte";
-		n_iter = hyper.n_train_samples / hyper.mini_batch_size;
-		batch_size = hyper.mini_batch_size;
+		n_samples = hyper.n_train_samples / hyper.mini_batch_size * hyper.mini_batch_size;
+		data.batch_size = hyper.mini_batch_size;
 	}
 	else if (dataset_type == "validation") {
 		ImagesFile = "executable/database/MNIST/t10k-images.idx3-ubyte";
 		LabelsFile = "executable/database/MNIST/t10k-labels.idx1-ubyte";
-		n_iter = hyper.n_val_samples;
-		batch_size = 1;
+		n_samples = hyper.n_val_samples;
+		data.batch_size = Dataset::eval_batch_size;
+	}
+	else if (dataset_type == "test") {
+		ImagesFile = "executable/database/MNIST/t10k-images.idx3-ubyte";
+		LabelsFile = "executable/database/MNIST/t10k-labels.idx1-ubyte";
+		data.batch_size = Dataset::eval_batch_size;
 	}
 	else
 		print("Dataset type is wrong");
 
-	readMNIST(ImagesFile, LabelsFile, images, labels);
-	d_matrix labels_hotOnes = hotOne(labels, 10);
-
-	Dataset data;
-	data.x.reserve(n_iter);
-	data.y.reserve(n_iter);
-
-	for (int n = 0; n < n_iter; n++) {
-		d_matrix x_train(&images[batch_size * n], &images[batch_size * (n + 1)]);
-		d_matrix y_train(&labels_hotOnes[batch_size * n], &labels_hotOnes[batch_size * (n + 1)]);
-
-		Matrix X(x_train);
-		Matrix Y(y_train);
-
-		data.x.emplace_back(std::move(X));
-		data.y.emplace_back(std::move(Y));
-	}
+	readMNIST(ImagesFile, LabelsFile, data.images, data.labels, n_samples);
+	// Training batches are all full, evaluation sets keep their remainder in a shorter last batch
+	if (dataset_type == "train")
+		data.n_batches = data.images.rows() / data.batch_size;
+	else
+		data.n_batches = (data.images.rows() + data.batch_size - 1) / data.batch_size;
 
 	return data;
 };
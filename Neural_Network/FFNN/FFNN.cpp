@@ -5,7 +5,7 @@
 FFNN::FFNN(const hyperparameters& hyper) : _hyper(hyper) {
 
 	// Getting the input and output dimensions into layer_sizes
-	d_vector layer_sizes = _hyper.hidden_layer_sizes;
+	i_vector layer_sizes = _hyper.hidden_layer_sizes;
 	layer_sizes.insert(layer_sizes.begin(), _hyper.input_dim);
 	layer_sizes.push_back(_hyper.output_dim);
 	L = layer_sizes.size() - 1;
@@ -13,42 +13,77 @@ FFNN::FFNN(const hyperparameters& hyper) : _hyper(hyper) {
 	// Getting the vectors ready
 	m_dW.resize(L);
 	m_dZ.resize(L);
+	m_dropout.resize(L);
 	m_layers.clear();
 	m_layers.reserve(L);
 	for (int l = 0; l < L; l++)
 		m_layers.emplace_back(layer_sizes[l], layer_sizes[l + 1]);
 }
 
-void FFNN::forward(Matrix& input, const bool learning) {
+void FFNN::forward(ConstMatrixView input, const bool learning, const LayerHook& before_layer) {
 
-	// Add dropout only when the FFNN is learning. Activate with softmax only if it's the last layer.
+	// Add dropout only when the FFNN is learning. Activate with softmax only if it's the last layer,
+	// and leave the logits when learning: backpropagation fuses the softmax with the loss.
+	const ActivationType last = learning ? ActivationType::Linear : ActivationType::Softmax;
+	before_layer(0);
 	m_layers[0].forward(input);
 	for (int l = 1; l < L; l++) {
-		ActivationType activation = (l == L - 1) ? ActivationType::Softmax : ActivationType::ReLU;
-		Matrix input_next = learning ? m_layers[l - 1].output().dropoutMask(_hyper.dropout_rate) : m_layers[l - 1].output();
-		m_layers[l].forward(input_next, activation);
+		ActivationType activation = (l == L - 1) ? last : ActivationType::ReLU;
+		const Matrix& previous = m_layers[l - 1].output();
+		if (learning)
+			previous.dropoutMask_into(m_dropout[l], _hyper.dropout_rate);
+		before_layer(l);
+		if (learning)
+			m_layers[l].forward(m_dropout[l], activation);
+		else
+			m_layers[l].forward(previous, activation);
 	}
-
-	m_output = m_layers.back().output();
 }
 
-void FFNN::backpropagation(Matrix& input, const Matrix& y_real) {
+// Expects the logits of a learning forward. Returns the batch loss and number of correct predictions.
+// layer_done(l) is called once layer l's dW is computed and its weights have been used for dZ of the layer below.
+LossStats FFNN::backpropagation(ConstMatrixView input, const int* labels, const LayerHook& layer_done) {
 
-	// Last layer of backprop
-	m_dZ[L - 1] = m_layers[L - 1].output() - y_real;
+	// Last layer of backprop: softmax, cross-entropy and dZ = softmax - onehot in one pass
+	LossStats stats = LOSS::softmax_cross_entropy(m_dZ[L - 1], m_layers[L - 1].output(), labels);
 	MATRIX_OPERATION::compute_dW_from_input(m_dW[L - 1], m_layers[L - 2].output(), m_dZ[L - 1]);
 
 	// Recurrent backprop
 	for (int l = L - 2; l >= 0; l--) {
-		MATRIX_OPERATION::compute_dZ_from_next(m_dZ[l], m_dZ[l + 1], m_layers[l + 1].weights(), m_layers[l].preactivation());
-		MATRIX_OPERATION::compute_dW_from_input(m_dW[l], (l == 0 ? input : m_layers[l - 1].output()), m_dZ[l]);
+		const DenseBlock& next = m_layers[l + 1];
+		MATRIX_OPERATION::compute_dZ_from_next(m_dZ[l], m_dZ[l + 1], next.weights(), m_layers[l].output());
+		MATRIX_OPERATION::compute_dW_from_input(m_dW[l], (l == 0 ? input : ConstMatrixView(m_layers[l - 1].output())), m_dZ[l]);
+		layer_done(l + 1);
 	}
+	layer_done(0);
+
+	return stats;
 }
 
+// Block-sparse layers are written as "sparse <rows> <cols>", then one line per weight row listing its kept blocks
+// as "<block column> <values>", then the dense bias row. Other layers are written dense.
 void FFNN::saveWeights(const std::string& filename) {
     std::ofstream file(filename);
     for (auto& layer : m_layers) {
-		Matrix W = layer.weights();
+		if (layer.weightFormat() == WeightFormat::Sparse) {
+			const SparseMatrix& W = layer.sparseWeights();
+			file << "sparse " << W.rows() << " " << W.cols() << "\n";
+			for (size_t p = 0; p < W.rows() - 1; p++) {
+				for (uint32_t b = W.row_start()[p]; b < W.row_start()[p + 1]; b++) {
+					file << W.block_col()[b] << " ";
+					const size_t width = std::min(W.block, W.cols() - W.block_col()[b] * W.block);
+					for (size_t j = 0; j < width; j++)
+						file << W.blocks()[b * W.block + j] << " ";
+				}
+				file << "\n";
+			}
+			for (size_t j = 0; j < W.cols(); j++)
+				file << W.bias()[j] << " ";
+			file << "\n===\n";
+			continue;
+		}
+
+		Matrix W = layer.fullWeights();
 		for (size_t i = 0; i < W.rows(); i++) {
 			for (size_t j = 0; j < W.cols(); j++)
 				file << W(i, j) << " ";
@@ -57,14 +92,42 @@ void FFNN::saveWeights(const std::string& filename) {
 		file << "===\n";
     } file.close();
 }
-void FFNN::loadWeights(const std::string& filename) {
+// One full weight matrix per layer, from either storage of saveWeights()
+std::vector<StoredLayer> readWeights(const std::string& filename) {
     std::ifstream file(filename); std::string line;
-    int layer_index = 0; d_matrix W;
+    std::vector<StoredLayer> layers; d_matrix W;
+    Matrix W_sparse; size_t sparse_row = 0; bool sparse = false;
     while (std::getline(file, line)) {
         if (line == "===") {
-            m_layers[layer_index].setWeights(W);
+            if (sparse)
+                layers.push_back({ W_sparse, true });
+            else
+                layers.push_back({ Matrix(W), false });
             W.clear();
-            layer_index++;
+            sparse = false;
+        }
+        else if (line.rfind("sparse ", 0) == 0) {
+            std::istringstream iss(line.substr(7));
+            size_t rows, cols;
+            iss >> rows >> cols;
+            W_sparse = Matrix(rows, cols);
+            sparse_row = 0;
+            sparse = true;
+        }
+        else if (sparse) {
+            // Weight rows hold (block column, values) groups, the last row is the dense bias
+            std::istringstream iss(line);
+            const size_t block = SparseMatrix::block;
+            const size_t cols = W_sparse.cols();
+            size_t b;
+            if (sparse_row == W_sparse.rows() - 1)
+                for (size_t j = 0; j < cols; j++)
+                    iss >> W_sparse(sparse_row, j);
+            else
+                while (iss >> b)
+                    for (size_t j = b * block; j < std::min((b + 1) * block, cols); j++)
+                        iss >> W_sparse(sparse_row, j);
+            sparse_row++;
         }
         else {
             std::istringstream iss(line);
@@ -75,4 +138,51 @@ void FFNN::loadWeights(const std::string& filename) {
             W.push_back(row);
         }
     } file.close();
-}
\ No newline at end of file
+    return layers;
+}
+
+void FFNN::loadWeights(const std::string& filename) {
+	std::vector<StoredLayer> layers = readWeights(filename);
+	assert(layers.size() == m_layers.size());
+	for (size_t l = 0; l < layers.size(); l++) {
+		m_layers[l].setWeights(layers[l].weights);
+		if (layers[l].sparse)
+			m_layers[l].sparsify();
+	}
+}
+
+// Rebuilds the packed copy of every layer whose weights were handed out for writing
+void FFNN::packWeights() {
+	for (auto& layer : m_layers)
+		layer.packWeights();
+}
+
+// Converts the loaded weights to bf16 / fp16 storage for inference, or back to full precision
+void FFNN::setWeightFormat(WeightFormat format) {
+	for (auto& layer : m_layers)
+		layer.setWeightFormat(format);
+}
+
+// Inference storage of pruned weights: layers with at most max_block_density of their blocks left (see Scope::prune) go block-sparse
+void FFNN::sparsify(double max_block_density) {
+	for (auto& layer : m_layers)
+		if (layer.weightFormat() == WeightFormat::Full && SparseMatrix::block_density(layer.weights()) <= max_block_density)
+			layer.sparsify();
+}
+
+// Post-training int8 quantization of every layer but the softmax one, which stays in float.
+// Each layer's input scale is calibrated on the largest input it sees over the calibration samples.
+void FFNN::quantize(ConstMatrixView calibration) {
+
+	d_vector input_max(L, 0.0);
+	forward(calibration, false);
+	for (int l = 0; l < L - 1; l++) {
+		ConstMatrixView input = (l == 0) ? calibration : ConstMatrixView(m_layers[l - 1].output());
+		for (size_t i = 0; i < input.rows(); i++)
+			for (size_t j = 0; j < input.cols(); j++)
+				input_max[l] = std::max<double>(input_max[l], input(i, j));
+	}
+
+	for (int l = 0; l < L - 1; l++)
+		m_layers[l].quantize(input_max[l]);
+}
@@ -5,6 +5,24 @@
 #define FFNN_HPP
 
 
+// Layers as written by FFNN::saveWeights: the full weight matrix (bias in its last row), and whether it was stored block-sparse
+struct StoredLayer {
+	Matrix weights;
+	bool sparse = false;
+};
+std::vector<StoredLayer> readWeights(const std::string& filename);
+
+
+// Called with a layer index by the pipelined training step (see Pipeline): before the layer's forward,
+// and during backprop as soon as the layer's weights and dW aren't read anymore
+struct LayerHook {
+	void (*call)(void* context, int l) = nullptr;
+	void* context = nullptr;
+
+	inline void operator()(int l) const { if (call) call(context, l); };
+};
+
+
 // ======== NEURAL NETWORK ======== //
 class FFNN {
 private:
@@ -15,33 +33,40 @@ private:
 
 	std::vector<Matrix> m_dW;
 	std::vector<Matrix> m_dZ;
+	std::vector<Matrix> m_dropout; // Dropped-out inputs of each layer, kept to reuse their storage
 
-	Matrix m_output;
+	std::vector<std::pair<Matrix*, Matrix*>> m_parameters;
 
 public:
 	FFNN(const hyperparameters& hyper);
 
-	void forward(Matrix& input, const bool learning = false);
-	void backpropagation(Matrix& input, const Matrix& y_real);
+	void forward(ConstMatrixView input, const bool learning = false, const LayerHook& before_layer = LayerHook());
+	LossStats backpropagation(ConstMatrixView input, const int* labels, const LayerHook& layer_done = LayerHook());
 
 	void saveWeights(const std::string& filename);
 	void loadWeights(const std::string& filename);
+	void packWeights();
+	inline void packWeights(int l) { m_layers[l].packWeights(); };
+	void setWeightFormat(WeightFormat format);
+	void quantize(ConstMatrixView calibration);
+	void sparsify(double max_block_density = 0.5);
 
-	inline std::vector<std::pair<Matrix*, Matrix*>> getParameters() {
-		std::vector<std::pair<Matrix*, Matrix*>> weights;
-		weights.reserve(L - 1);
+	// Rebuilt in place on every call (the pointers must follow copies of the model), without reallocating
+	inline const std::vector<std::pair<Matrix*, Matrix*>>& getParameters() {
+		m_parameters.clear();
 		for (int l = 0; l < L - 1; l++)
-			weights.emplace_back(&m_layers[l].weights(), &m_dW[l]);
-		return weights;
+			m_parameters.emplace_back(&m_layers[l].weights(), &m_dW[l]);
+		return m_parameters;
 	};
+	// One layer's parameters, through the non-const weights() too (for updates of single layers, see Pipeline)
+	inline std::pair<Matrix*, Matrix*> getParameters(int l) { return { &m_layers[l].weights(), &m_dW[l] }; };
 	inline const DenseBlock& getLayer(int l) { return m_layers[l]; };
-	inline const Matrix& getOutput() const { return m_output; };
+	inline const Matrix& getOutput() const { return m_layers.back().output(); }; // Logits after a learning forward
+	// Copies into the existing buffers, so repeated copies (validation snapshots) don't allocate
 	inline void copyLayers(const FFNN& model) {
 		assert(L == model.L);
-		for (int l = 0; l < L; ++l) {
-			Matrix copy = model.m_layers[l].weights();
-			m_layers[l].weights() = copy;
-		}
+		for (int l = 0; l < L; ++l)
+			m_layers[l].weights() = model.m_layers[l].weights();
 	}
 
 };
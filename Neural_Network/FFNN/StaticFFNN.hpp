@@ -0,0 +1,138 @@
+#include <array>
+#include <tuple>
+#include <utility>
+
+#include "FFNN.hpp"
+
+#ifndef STATIC_FFNN_HPP
+#define STATIC_FFNN_HPP
+
+
+// ======== STATIC DENSE LAYER ======== //
+// Weights of a In -> Out layer in a fixed-size array, bias in the last row as in DenseBlock.
+template<size_t In, size_t Out>
+struct StaticDense {
+	alignas(64) std::array<real, (In + 1) * Out> weights{};
+
+	// Layers this narrow keep their outputs in scalar registers: fully unrolled over Out
+	static constexpr size_t narrow = 16;
+
+	// y = a(x * W + bias) for one sample, zero inputs skipped
+	template<bool Relu>
+	inline void forward(const real* x, real* y) const {
+		const real* bias = weights.data() + In * Out;
+
+		if constexpr (Out <= narrow) {
+			real acc[Out];
+#pragma GCC unroll 16
+			for (size_t j = 0; j < Out; j++)
+				acc[j] = bias[j];
+			for (size_t k = 0; k < In; k++) {
+				const real x_k = x[k];
+				if (x_k == real(0))
+					continue;
+				const real* W_row = weights.data() + k * Out;
+#pragma GCC unroll 16
+				for (size_t j = 0; j < Out; j++)
+					acc[j] += x_k * W_row[j];
+			}
+#pragma GCC unroll 16
+			for (size_t j = 0; j < Out; j++)
+				y[j] = Relu ? std::max(acc[j], real(0)) : acc[j];
+		}
+		else {
+			// Wide layers: the non-zero inputs through the SIMD sparse-row kernel
+			real values[In];
+			uint32_t index[In];
+			size_t nnz = 0;
+			for (size_t k = 0; k < In; k++)
+				if (x[k] != real(0)) {
+					values[nnz] = x[k];
+					index[nnz++] = static_cast<uint32_t>(k);
+				}
+			KERNELS::get<real>().sparse_row(nnz, values, index, weights.data(), Out, Out, y, bias, Relu);
+		}
+	};
+};
+
+
+// ======== STATIC NEURAL NETWORK ======== //
+// Inference-only network whose topology is fixed at compile time, e.g. StaticFFNN<784, 256, 128, 10>:
+// ReLU hidden layers, softmax output, as FFNN::forward outside of training.
+// Every shape is constexpr, weights live inside the object (allocate it static or on the heap, not on the stack)
+// and activations on the stack. Loads the same weight files as FFNN (block-sparse layers are stored back dense).
+template<size_t... Sizes>
+class StaticFFNN {
+	static_assert(sizeof...(Sizes) >= 2, "StaticFFNN needs at least an input and an output size");
+
+private:
+	static constexpr size_t sizes[] = { Sizes... };
+	static constexpr size_t L = sizeof...(Sizes) - 1;
+
+	template<size_t... I>
+	static auto make_layers(std::index_sequence<I...>) -> std::tuple<StaticDense<sizes[I], sizes[I + 1]>...>;
+	using Layers = decltype(make_layers(std::make_index_sequence<L>()));
+
+	Layers m_layers;
+
+	static constexpr size_t max_width() {
+		size_t width = 0;
+		for (size_t l = 1; l < L; l++)
+			width = std::max(width, sizes[l]);
+		return std::max<size_t>(width, 1);
+	};
+
+	// Hidden activations ping-pong between a and b, the last layer writes y
+	template<size_t l>
+	inline void forward_from(const real* x, real* a, real* b, real* y) const {
+		if constexpr (l == L - 1)
+			std::get<l>(m_layers).template forward<false>(x, y);
+		else {
+			std::get<l>(m_layers).template forward<true>(x, a);
+			forward_from<l + 1>(a, b, a, y);
+		}
+	};
+
+	template<size_t l>
+	inline void set_from(const std::vector<StoredLayer>& stored) {
+		auto& weights = std::get<l>(m_layers).weights;
+		const Matrix& W = stored[l].weights;
+		assert(W.rows() == sizes[l] + 1 && W.cols() == sizes[l + 1] && "weight file doesn't match the static topology");
+		std::copy(W.data(), W.data() + weights.size(), weights.begin());
+		if constexpr (l + 1 < L)
+			set_from<l + 1>(stored);
+	};
+
+public:
+	static constexpr size_t input_dim = sizes[0];
+	static constexpr size_t output_dim = sizes[L];
+
+	inline void loadWeights(const std::string& filename) {
+		std::vector<StoredLayer> stored = readWeights(filename);
+		assert(stored.size() == L);
+		set_from<0>(stored);
+	};
+
+	// One sample: y = softmax(...) of the input_dim values at x, output_dim values
+	inline void forward(const real* x, real* y) const {
+		alignas(64) real a[max_width()];
+		alignas(64) real b[max_width()];
+		forward_from<0>(x, a, b, y);
+		KERNELS::get<real>().softmax_row(output_dim, y, y, nullptr, nullptr);
+	};
+
+	// A batch, one row at a time (output: rows x output_dim)
+	inline void forward(ConstMatrixView input, MatrixView output) const {
+		assert(input.cols() == input_dim && output.cols() == output_dim && output.rows() == input.rows());
+		for (size_t i = 0; i < input.rows(); i++)
+			forward(input.row_data(i), output.row_data(i));
+	};
+
+	inline int predict(const real* x) const {
+		std::array<real, output_dim> y;
+		forward(x, y.data());
+		return static_cast<int>(std::max_element(y.begin(), y.end()) - y.begin());
+	};
+};
+
+#endif
@@ -0,0 +1,81 @@
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <atomic>
+#if defined(_WIN32)
+#include <malloc.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+
+#ifndef ALIGNED_ALLOCATOR_HPP
+#define ALIGNED_ALLOCATOR_HPP
+
+
+// ======== ALIGNED STORAGE ======== //
+// Matrix and packing buffers start on a cache line, so SIMD loads never straddle two lines.
+// Optionally, buffers of at least hugepage_threshold() bytes are placed on 2 MiB boundaries and
+// madvise(MADV_HUGEPAGE)'d, so transparent huge pages can back them (Linux only, no-op elsewhere).
+namespace MEMORY {
+
+	constexpr size_t alignment = 64;
+	constexpr size_t hugepage_size = size_t(2) << 20;
+
+	// 0 disables the huge-page policy (default)
+	inline std::atomic<size_t>& hugepage_threshold_storage() {
+		static std::atomic<size_t> threshold{ 0 };
+		return threshold;
+	};
+	inline size_t hugepage_threshold() { return hugepage_threshold_storage().load(std::memory_order_relaxed); };
+	inline void set_hugepage_threshold(size_t bytes) { hugepage_threshold_storage().store(bytes, std::memory_order_relaxed); };
+
+	inline void* allocate(size_t bytes) {
+		const size_t threshold = hugepage_threshold();
+		const bool huge = threshold && bytes >= threshold;
+		const size_t align = huge ? hugepage_size : alignment;
+		bytes = (bytes + align - 1) / align * align;
+
+#if defined(_WIN32)
+		void* p = _aligned_malloc(bytes, align);
+#else
+		void* p = std::aligned_alloc(align, bytes);
+#endif
+		if (!p)
+			throw std::bad_alloc();
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+		if (huge)
+			madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+		return p;
+	};
+
+	inline void deallocate(void* p) {
+#if defined(_WIN32)
+		_aligned_free(p);
+#else
+		std::free(p);
+#endif
+	};
+
+	template<typename T>
+	struct AlignedAllocator {
+		using value_type = T;
+
+		AlignedAllocator() = default;
+		template<typename U> AlignedAllocator(const AlignedAllocator<U>&) {};
+
+		inline T* allocate(size_t n) { return static_cast<T*>(MEMORY::allocate(n * sizeof(T))); };
+		inline void deallocate(T* p, size_t) { MEMORY::deallocate(p); };
+
+		template<typename U> inline bool operator==(const AlignedAllocator<U>&) const { return true; };
+		template<typename U> inline bool operator!=(const AlignedAllocator<U>&) const { return false; };
+	};
+
+	template<typename T>
+	using aligned_vector = std::vector<T, AlignedAllocator<T>>;
+}
+
+#endif
@@ -0,0 +1,257 @@
+#include "Backend.hpp"
+
+#include "Kernels.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+
+
+namespace BACKEND {
+
+	template<typename T>
+	static inline void apply_epilogue(size_t m, size_t n, T* C, size_t ldc, const GEMM::Epilogue<T>& epilogue) {
+		if (!epilogue.bias && !epilogue.relu)
+			return;
+		for (size_t i = 0; i < m; i++)
+			for (size_t j = 0; j < n; j++) {
+				T out = C[i * ldc + j];
+				if (epilogue.bias) out += epilogue.bias[j];
+				if (epilogue.relu) out = std::max(out, T(0));
+				C[i * ldc + j] = out;
+			}
+	}
+
+	template<typename T>
+	static T sum(size_t n, const T* x) {
+		T total = T(0);
+		for (size_t i = 0; i < n; i++)
+			total += x[i];
+		return total;
+	}
+
+	template<typename T>
+	static size_t argmax(size_t n, const T* x) {
+		size_t max_index = 0;
+		for (size_t i = 1; i < n; i++)
+			if (x[i] > x[max_index])
+				max_index = i;
+		return max_index;
+	}
+
+	template<typename T>
+	static void hadamard(size_t n, const T* x, T* y) {
+		for (size_t i = 0; i < n; i++)
+			y[i] *= x[i];
+	}
+
+
+	// ======== REFERENCE ======== //
+	namespace REFERENCE {
+
+		template<typename T>
+		static void gemm(bool trans_a, bool trans_b, size_t m, size_t n, size_t k, const T* A, size_t lda, const T* B, size_t ldb, T* C, size_t ldc, bool accumulate, const GEMM::Epilogue<T>& epilogue) {
+			for (size_t i = 0; i < m; i++)
+				for (size_t j = 0; j < n; j++) {
+					T out = accumulate ? C[i * ldc + j] : T(0);
+					for (size_t p = 0; p < k; p++)
+						out += (trans_a ? A[p * lda + i] : A[i * lda + p]) * (trans_b ? B[j * ldb + p] : B[p * ldb + j]);
+					C[i * ldc + j] = out;
+				}
+			apply_epilogue(m, n, C, ldc, epilogue);
+		}
+
+		template<typename T>
+		static void gemv(size_t k, size_t n, const T* x, const T* A, size_t lda, T* y, bool accumulate, const GEMM::Epilogue<T>& epilogue) {
+			gemm(false, false, 1, n, k, x, k, A, lda, y, n, accumulate, epilogue);
+		}
+
+		template<typename T>
+		static void axpy(size_t n, T alpha, const T* x, T* y) {
+			for (size_t i = 0; i < n; i++)
+				y[i] += alpha * x[i];
+		}
+
+		template<typename T>
+		static void relu_mask(size_t n, T* y, const T* mask) {
+			for (size_t i = 0; i < n; i++)
+				y[i] = mask[i] > T(0) ? y[i] : T(0);
+		}
+
+		template<typename T>
+		static T softmax_row(size_t n, const T* x, T* y, T* row_max, size_t* argmax_index) {
+			const size_t max_index = argmax(n, x);
+			const T max = x[max_index];
+			if (row_max) *row_max = max;
+			if (argmax_index) *argmax_index = max_index;
+
+			T sum_of_exps = 0;
+			for (size_t j = 0; j < n; j++) {
+				y[j] = std::exp(x[j] - max);
+				sum_of_exps += y[j];
+			}
+			const T inv_sum = T(1) / sum_of_exps;
+			for (size_t j = 0; j < n; j++)
+				y[j] *= inv_sum;
+			return sum_of_exps;
+		}
+
+		template<typename T>
+		static void log_row(size_t n, const T* x, T* y) {
+			for (size_t i = 0; i < n; i++)
+				y[i] = std::log(x[i]);
+		}
+
+		// Moments first, then the weights, as two sweeps
+		template<typename T>
+		static void adam(size_t n, T* W, const T* dW, T* M, T* V, const AdamStep<T>& step) {
+			for (size_t i = 0; i < n; i++) {
+				M[i] = M[i] * step.beta_1 + dW[i] * (1 - step.beta_1);
+				V[i] = V[i] * step.beta_2 + dW[i] * dW[i] * (1 - step.beta_2);
+			}
+			for (size_t i = 0; i < n; i++) {
+				const T M_hat = M[i] / step.bias_1_correction;
+				const T V_hat = V[i] / step.bias_2_correction;
+				W[i] -= (M_hat / (std::sqrt(V_hat) + step.epsilon)) * step.learning_rate;
+			}
+		}
+	}
+
+	template<typename T>
+	Backend<T> reference_backend() {
+		using namespace REFERENCE;
+		return Backend<T>{ Kind::Reference, "reference", gemm<T>, nullptr, gemv<T>, axpy<T>, hadamard<T>, relu_mask<T>, softmax_row<T>, log_row<T>, sum<T>, argmax<T>, adam<T> };
+	}
+
+
+	// ======== OPTIMIZED ======== //
+	// Element-wise work is split between the pool threads in chunks of at least grain elements, cut on cache lines
+	namespace OPTIMIZED {
+
+		constexpr size_t grain = size_t(1) << 14;
+		constexpr size_t chunk_align = 16;
+
+		template<typename T>
+		static void gemm(bool trans_a, bool trans_b, size_t m, size_t n, size_t k, const T* A, size_t lda, const T* B, size_t ldb, T* C, size_t ldc, bool accumulate, const GEMM::Epilogue<T>& epilogue) {
+			assert(!(trans_a && trans_b));
+			if (trans_a)
+				GEMM::gemm_tn(m, n, k, A, lda, B, ldb, C, ldc, accumulate, epilogue);
+			else if (trans_b)
+				GEMM::gemm_nt(m, n, k, A, lda, B, ldb, C, ldc, accumulate, epilogue);
+			else
+				GEMM::gemm(m, n, k, A, lda, B, ldb, C, ldc, accumulate, epilogue);
+		}
+
+		template<typename T>
+		static void gemm_packed(size_t m, const T* A, size_t lda, const GEMM::PackedB<T>& B, T* C, size_t ldc, bool accumulate, const GEMM::Epilogue<T>& epilogue) {
+			GEMM::gemm(m, A, lda, B, C, ldc, accumulate, epilogue);
+		}
+
+		template<typename T>
+		static void gemv(size_t k, size_t n, const T* x, const T* A, size_t lda, T* y, bool accumulate, const GEMM::Epilogue<T>& epilogue) {
+			GEMM::gemm(1, n, k, x, k, A, lda, y, n, accumulate, epilogue);
+		}
+
+		template<typename T>
+		static void axpy(size_t n, T alpha, const T* x, T* y) {
+			THREADS::parallel_ranges(n, grain, [&](size_t begin, size_t end) {
+				if (alpha == T(1)) {
+					KERNELS::get<T>().axpy(end - begin, x + begin, y + begin);
+					return;
+				}
+				for (size_t i = begin; i < end; i++)
+					y[i] += alpha * x[i];
+			}, chunk_align);
+		}
+
+		template<typename T>
+		static void hadamard(size_t n, const T* x, T* y) {
+			THREADS::parallel_ranges(n, grain, [&](size_t begin, size_t end) { BACKEND::hadamard(end - begin, x + begin, y + begin); }, chunk_align);
+		}
+
+		template<typename T>
+		static void relu_mask(size_t n, T* y, const T* mask) {
+			THREADS::parallel_ranges(n, grain, [&](size_t begin, size_t end) { KERNELS::get<T>().relu_mask(end - begin, y + begin, mask + begin); }, chunk_align);
+		}
+		template<typename T>
+		static T softmax_row(size_t n, const T* x, T* y, T* row_max, size_t* argmax_index) { return KERNELS::get<T>().softmax_row(n, x, y, row_max, argmax_index); }
+		template<typename T>
+		static void log_row(size_t n, const T* x, T* y) { KERNELS::get<T>().log_row(n, x, y); }
+
+		// Moments and weights in one sweep, same arithmetic as the reference
+		template<typename T>
+		static void adam(size_t n, T* W, const T* dW, T* M, T* V, const AdamStep<T>& step) {
+			THREADS::parallel_ranges(n, grain, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++) {
+					const T m = M[i] * step.beta_1 + dW[i] * (1 - step.beta_1);
+					const T v = V[i] * step.beta_2 + dW[i] * dW[i] * (1 - step.beta_2);
+					M[i] = m;
+					V[i] = v;
+					W[i] -= (m / step.bias_1_correction / (std::sqrt(v / step.bias_2_correction) + step.epsilon)) * step.learning_rate;
+				}
+			}, chunk_align);
+		}
+	}
+
+	template<typename T>
+	Backend<T> optimized_backend() {
+		using namespace OPTIMIZED;
+		return Backend<T>{ Kind::Optimized, "optimized", gemm<T>, gemm_packed<T>, gemv<T>, axpy<T>, OPTIMIZED::hadamard<T>, relu_mask<T>, softmax_row<T>, log_row<T>, sum<T>, argmax<T>, adam<T> };
+	}
+
+
+	// ======== SELECTION ======== //
+	static Kind from_environment() {
+		const char* name = std::getenv("FFNN_BACKEND");
+		if (name && std::string(name) == "reference")
+			return Kind::Reference;
+		if (name && std::string(name) == "cblas" && cblas_available())
+			return Kind::CBLAS;
+		return Kind::Optimized;
+	}
+
+	static std::atomic<Kind>& current() {
+		static std::atomic<Kind> kind{ from_environment() };
+		return kind;
+	}
+
+	Kind selected() {
+		return current().load(std::memory_order_relaxed);
+	}
+
+	bool select(Kind kind) {
+		if (kind == Kind::CBLAS && !cblas_available())
+			return false;
+		current().store(kind, std::memory_order_relaxed);
+		return true;
+	}
+
+	bool select(const std::string& name) {
+		if (name == "reference") return select(Kind::Reference);
+		if (name == "optimized") return select(Kind::Optimized);
+		if (name == "cblas") return select(Kind::CBLAS);
+		return false;
+	}
+
+	template<typename T>
+	const Backend<T>& get() {
+		static const Backend<T> reference = reference_backend<T>();
+		static const Backend<T> optimized = optimized_backend<T>();
+		static const Backend<T> cblas = cblas_backend<T>();
+		switch (selected()) {
+		case Kind::Reference: return reference;
+		case Kind::CBLAS: return cblas;
+		default: return optimized;
+		}
+	}
+
+	template Backend<float> reference_backend<float>();
+	template Backend<double> reference_backend<double>();
+	template Backend<float> optimized_backend<float>();
+	template Backend<double> optimized_backend<double>();
+	template const Backend<float>& get<float>();
+	template const Backend<double>& get<double>();
+}
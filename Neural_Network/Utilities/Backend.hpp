@@ -0,0 +1,88 @@
+#include <cstddef>
+#include <string>
+
+#include "Gemm.hpp"
+
+
+#ifndef BACKEND_HPP
+#define BACKEND_HPP
+
+
+// ======== COMPUTE BACKENDS ======== //
+// The dense arithmetic of DenseBlock, FFNN and Scope goes through one of these tables, swappable at runtime
+// so kernels can be A/B tested without a rebuild:
+// - Reference: plain loops, the behaviour everything else is checked against,
+// - Optimized: the blocked GEMM engine and the SIMD kernel tables (default),
+// - CBLAS: gemm / gemv / axpy from the system BLAS, the rest from Optimized. Only built with -DFFNN_CBLAS.
+// The first call picks the FFNN_BACKEND environment variable (reference, optimized or cblas) if set.
+// Storage-specific paths (sparse inputs, block-sparse, bf16 / fp16 and int8 weights) stay on KERNELS / GEMM.
+namespace BACKEND {
+
+	enum class Kind { Reference, Optimized, CBLAS };
+
+	// W -= learning_rate * (M / bias_1_correction) / (sqrt(V / bias_2_correction) + epsilon),
+	// after M = beta_1 M + (1 - beta_1) dW and V = beta_2 V + (1 - beta_2) dW^2
+	template<typename T>
+	struct AdamStep {
+		T beta_1;
+		T beta_2;
+		T learning_rate;
+		T bias_1_correction;
+		T bias_2_correction;
+		T epsilon;
+	};
+
+	template<typename T>
+	struct Backend {
+		// C (m x n) = op(A) * op(B) (+ C if accumulate), op transposing when trans_*, then the epilogue. Row-major.
+		using gemm_fn = void (*)(bool trans_a, bool trans_b, size_t m, size_t n, size_t k, const T* A, size_t lda, const T* B, size_t ldb, T* C, size_t ldc, bool accumulate, const GEMM::Epilogue<T>& epilogue);
+		// Same with B pre-packed; null when the backend can't use GEMM::PackedB
+		using gemm_packed_fn = void (*)(size_t m, const T* A, size_t lda, const GEMM::PackedB<T>& B, T* C, size_t ldc, bool accumulate, const GEMM::Epilogue<T>& epilogue);
+		// y (n) = x (k) * A (k x n) (+ y if accumulate), then the epilogue
+		using gemv_fn = void (*)(size_t k, size_t n, const T* x, const T* A, size_t lda, T* y, bool accumulate, const GEMM::Epilogue<T>& epilogue);
+		// y += alpha x
+		using axpy_fn = void (*)(size_t n, T alpha, const T* x, T* y);
+		// y *= x, element-wise
+		using hadamard_fn = void (*)(size_t n, const T* x, T* y);
+		// y *= (mask > 0)
+		using relu_mask_fn = void (*)(size_t n, T* y, const T* mask);
+		// Same contracts as in KERNELS::Table
+		using softmax_row_fn = T (*)(size_t n, const T* x, T* y, T* row_max, size_t* argmax);
+		using log_row_fn = void (*)(size_t n, const T* x, T* y);
+		// Reductions: sum, and first index of the max
+		using sum_fn = T (*)(size_t n, const T* x);
+		using argmax_fn = size_t (*)(size_t n, const T* x);
+		// One Adam update of n parameters
+		using adam_fn = void (*)(size_t n, T* W, const T* dW, T* M, T* V, const AdamStep<T>& step);
+
+		Kind kind;
+		const char* name;
+		gemm_fn gemm;
+		gemm_packed_fn gemm_packed;
+		gemv_fn gemv;
+		axpy_fn axpy;
+		hadamard_fn hadamard;
+		relu_mask_fn relu_mask;
+		softmax_row_fn softmax_row;
+		log_row_fn log_row;
+		sum_fn sum;
+		argmax_fn argmax;
+		adam_fn adam;
+	};
+
+	// Current backend
+	template<typename T> const Backend<T>& get();
+	Kind selected();
+
+	// false (and nothing changes) if the backend isn't built in. Not meant to be called while another thread computes.
+	bool select(Kind kind);
+	bool select(const std::string& name);
+
+	template<typename T> Backend<T> reference_backend();
+	template<typename T> Backend<T> optimized_backend();
+	// Optimized with the BLAS entry points swapped in; kind stays Optimized when built without FFNN_CBLAS
+	template<typename T> Backend<T> cblas_backend();
+	bool cblas_available();
+}
+
+#endif
@@ -0,0 +1,88 @@
+#include "Backend.hpp"
+
+#include <algorithm>
+#include <type_traits>
+
+#ifdef FFNN_CBLAS
+#include <cblas.h>
+#endif
+
+
+// ======== CBLAS BACKEND ======== //
+// Built with -DFFNN_CBLAS (and linked with the BLAS, e.g. -lopenblas): gemm, gemv and axpy call the
+// system BLAS, the epilogue runs as a separate sweep. Without it, cblas_backend() is the optimized one.
+namespace BACKEND {
+
+#ifdef FFNN_CBLAS
+	namespace CBLAS {
+
+		template<typename T>
+		static void epilogue_sweep(size_t m, size_t n, T* C, size_t ldc, const GEMM::Epilogue<T>& epilogue) {
+			if (!epilogue.bias && !epilogue.relu)
+				return;
+			for (size_t i = 0; i < m; i++)
+				for (size_t j = 0; j < n; j++) {
+					T out = C[i * ldc + j];
+					if (epilogue.bias) out += epilogue.bias[j];
+					if (epilogue.relu) out = std::max(out, T(0));
+					C[i * ldc + j] = out;
+				}
+		}
+
+		template<typename T>
+		static void gemm(bool trans_a, bool trans_b, size_t m, size_t n, size_t k, const T* A, size_t lda, const T* B, size_t ldb, T* C, size_t ldc, bool accumulate, const GEMM::Epilogue<T>& epilogue) {
+			const CBLAS_TRANSPOSE op_a = trans_a ? CblasTrans : CblasNoTrans;
+			const CBLAS_TRANSPOSE op_b = trans_b ? CblasTrans : CblasNoTrans;
+			const T beta = accumulate ? T(1) : T(0);
+			if (m && n) {
+				if constexpr (std::is_same<T, float>::value)
+					cblas_sgemm(CblasRowMajor, op_a, op_b, m, n, k, 1.f, A, lda, B, ldb, beta, C, ldc);
+				else
+					cblas_dgemm(CblasRowMajor, op_a, op_b, m, n, k, 1.0, A, lda, B, ldb, beta, C, ldc);
+			}
+			epilogue_sweep(m, n, C, ldc, epilogue);
+		}
+
+		// x * A is A^T x for the column-vector BLAS
+		template<typename T>
+		static void gemv(size_t k, size_t n, const T* x, const T* A, size_t lda, T* y, bool accumulate, const GEMM::Epilogue<T>& epilogue) {
+			const T beta = accumulate ? T(1) : T(0);
+			if constexpr (std::is_same<T, float>::value)
+				cblas_sgemv(CblasRowMajor, CblasTrans, k, n, 1.f, A, lda, x, 1, beta, y, 1);
+			else
+				cblas_dgemv(CblasRowMajor, CblasTrans, k, n, 1.0, A, lda, x, 1, beta, y, 1);
+			epilogue_sweep(1, n, y, n, epilogue);
+		}
+
+		template<typename T>
+		static void axpy(size_t n, T alpha, const T* x, T* y) {
+			if constexpr (std::is_same<T, float>::value)
+				cblas_saxpy(n, alpha, x, 1, y, 1);
+			else
+				cblas_daxpy(n, alpha, x, 1, y, 1);
+		}
+	}
+
+	bool cblas_available() { return true; }
+
+	template<typename T>
+	Backend<T> cblas_backend() {
+		Backend<T> backend = optimized_backend<T>();
+		backend.kind = Kind::CBLAS;
+		backend.name = "cblas";
+		backend.gemm = CBLAS::gemm<T>;
+		backend.gemm_packed = nullptr;
+		backend.gemv = CBLAS::gemv<T>;
+		backend.axpy = CBLAS::axpy<T>;
+		return backend;
+	}
+#else
+	bool cblas_available() { return false; }
+
+	template<typename T>
+	Backend<T> cblas_backend() { return optimized_backend<T>(); }
+#endif
+
+	template Backend<float> cblas_backend<float>();
+	template Backend<double> cblas_backend<double>();
+}
@@ -0,0 +1,259 @@
+#include "Gemm.hpp"
+
+#include "Kernels.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+
+namespace GEMM {
+
+	// ======== BLOCKING ======== //
+	template<typename T>
+	static Blocking& current_blocking() {
+		static Blocking b;
+		return b;
+	}
+
+	template<typename T>
+	const Blocking& blocking() {
+		return current_blocking<T>();
+	}
+
+	template<typename T>
+	void set_blocking(Blocking b) {
+		const KERNELS::Table<T>& kernels = KERNELS::get<T>();
+		assert(b.tile < kernels.n_tiles && b.kc > 0);
+		const typename KERNELS::Table<T>::Tile& tile = kernels.tiles[b.tile];
+		b.mc = std::max(b.mc / tile.mr, size_t(1)) * tile.mr;
+		b.nc = std::max(b.nc / tile.nr, size_t(1)) * tile.nr;
+		current_blocking<T>() = b;
+	}
+
+
+	// ======== PACKING ======== //
+	// A block (mc x kc) -> consecutive MR-row panels, column by column. Missing rows are zero-padded.
+	// TransA: A is stored transposed (kc x mc), so each packed column is a contiguous run of a row.
+	template<bool TransA, typename T>
+	static void pack_A(size_t MR, size_t mc, size_t kc, const T* A, size_t lda, T* packed) {
+		for (size_t ir = 0; ir < mc; ir += MR) {
+			const size_t mr = std::min(MR, mc - ir);
+			for (size_t p = 0; p < kc; p++) {
+				for (size_t i = 0; i < mr; i++)
+					packed[i] = TransA ? A[p * lda + ir + i] : A[(ir + i) * lda + p];
+				for (size_t i = mr; i < MR; i++)
+					packed[i] = T(0);
+				packed += MR;
+			}
+		}
+	}
+
+	// B panel (kc x nc) -> consecutive NR-column panels, row by row. Missing columns are zero-padded.
+	// B may be stored narrower than T (bf16 / fp16): it is widened here, once per panel.
+	// TransB: B is stored transposed (nc x kc).
+	template<bool TransB, typename T, typename S, typename Widen>
+	static void pack_B(size_t NR, size_t kc, size_t nc, const S* B, size_t ldb, T* packed, const Widen& widen) {
+		for (size_t jr = 0; jr < nc; jr += NR) {
+			const size_t nr = std::min(NR, nc - jr);
+			for (size_t p = 0; p < kc; p++) {
+				for (size_t j = 0; j < nr; j++)
+					packed[j] = widen(TransB ? B[(jr + j) * ldb + p] : B[p * ldb + jr + j]);
+				for (size_t j = nr; j < NR; j++)
+					packed[j] = T(0);
+				packed += NR;
+			}
+		}
+	}
+
+
+	// ======== THREADING ======== //
+	// Below this many multiply-adds a product stays on the calling thread
+	constexpr size_t parallel_threshold = size_t(1) << 16;
+
+	// Packing buffers are kept per thread (caller and workers alike) and only ever grow
+	template<typename T>
+	static T* packing_buffer(size_t size, int which) {
+		thread_local MEMORY::aligned_vector<T> buffers[2];
+		if (buffers[which].size() < size) buffers[which].resize(size);
+		return buffers[which].data();
+	}
+
+	// Runs of NR panels each thread takes from an nc-wide block, so that every thread gets work
+	// even when m fits in a single MC block (a 32-sample batch)
+	static size_t column_groups(size_t m_blocks, size_t n_panels, size_t work) {
+		const size_t threads = THREADS::threads();
+		if (threads == 1 || work < parallel_threshold)
+			return 1;
+		return std::min(n_panels, (threads + m_blocks - 1) / m_blocks);
+	}
+
+
+	// ======== DRIVER ======== //
+	// block_B(pc, jc, kc, nc) returns the packed kc x nc block of B at (pc, jc): packed on the fly,
+	// or straight out of a PackedB. Transposed operands only change how blocks are packed,
+	// the microkernel always sees the same panels.
+	// Each (pc, jc) block is split between the threads by MC row blocks and runs of NR panels. Every C tile
+	// sees the same microkernel calls in the same order whatever the thread count, so results don't change with it.
+	template<bool TransA, typename T, typename BlockB>
+	static void gemm_driver(size_t m, size_t n, size_t k, const T* A, size_t lda, T* C, size_t ldc, bool accumulate, const Epilogue<T>& epilogue, const Blocking& blocking, const BlockB& block_B) {
+
+		if (m == 0 || n == 0)
+			return;
+		if (k == 0) {
+			for (size_t i = 0; i < m; i++)
+				for (size_t j = 0; j < n; j++) {
+					T out = accumulate ? C[i * ldc + j] : T(0);
+					if (epilogue.bias) out += epilogue.bias[j];
+					if (epilogue.relu) out = std::max(out, T(0));
+					C[i * ldc + j] = out;
+				}
+			return;
+		}
+
+		const typename KERNELS::Table<T>::Tile& tile = KERNELS::get<T>().tiles[blocking.tile];
+		const size_t MR = tile.mr;
+		const size_t NR = tile.nr;
+		const size_t MC = blocking.mc;
+		const size_t KC = blocking.kc;
+		const size_t NC = blocking.nc;
+
+		const size_t mc_max = std::min(MC, (m + MR - 1) / MR * MR);
+		const size_t m_blocks = (m + MC - 1) / MC;
+
+		for (size_t jc = 0; jc < n; jc += NC) {
+			const size_t nc = std::min(NC, n - jc);
+			const size_t n_panels = (nc + NR - 1) / NR;
+			const size_t groups = column_groups(m_blocks, n_panels, m * nc * k);
+
+			for (size_t pc = 0; pc < k; pc += KC) {
+				const size_t kc = std::min(KC, k - pc);
+				const bool acc = accumulate || pc > 0;
+				const bool last = pc + kc == k;
+				const T* B_packed = block_B(pc, jc, kc, nc);
+
+				THREADS::parallel_for(m_blocks * groups, [&](size_t task) {
+					const size_t ic = (task % m_blocks) * MC;
+					const size_t group = task / m_blocks;
+					const size_t mc = std::min(MC, m - ic);
+					const size_t jr_begin = n_panels * group / groups * NR;
+					const size_t jr_end = std::min(nc, n_panels * (group + 1) / groups * NR);
+
+					T* A_packed = packing_buffer<T>(KC * mc_max, 0);
+					pack_A<TransA>(MR, mc, kc, TransA ? A + pc * lda + ic : A + ic * lda + pc, lda, A_packed);
+
+					for (size_t jr = jr_begin; jr < jr_end; jr += NR) {
+						const size_t nr = std::min(NR, nc - jr);
+						const T* B_panel = B_packed + jr * kc;
+
+						for (size_t ir = 0; ir < mc; ir += MR) {
+							const size_t mr = std::min(MR, mc - ir);
+							const T* A_panel = A_packed + ir * kc;
+							tile.microkernel(kc, A_panel, B_panel, C + (ic + ir) * ldc + jc + jr, ldc, mr, nr, acc,
+												last && epilogue.bias ? epilogue.bias + jc + jr : nullptr, last && epilogue.relu);
+						}
+					}
+				});
+			}
+		}
+	}
+
+	// B (kc x nc) packed as n_panels NR-column panels, split between the threads by runs of panels
+	template<bool TransB, typename T, typename S, typename Widen>
+	static void pack_B_parallel(size_t NR, size_t kc, size_t nc, const S* B, size_t ldb, T* packed, const Widen& widen) {
+		const size_t n_panels = (nc + NR - 1) / NR;
+		const size_t tasks = kc * nc < parallel_threshold ? 1 : std::min(n_panels, THREADS::threads());
+		THREADS::parallel_for(tasks, [&](size_t task) {
+			const size_t jr_begin = n_panels * task / tasks * NR;
+			const size_t jr_end = std::min(nc, n_panels * (task + 1) / tasks * NR);
+			if (jr_begin < jr_end)
+				pack_B<TransB>(NR, kc, jr_end - jr_begin, TransB ? B + jr_begin * ldb : B + jr_begin, ldb, packed + jr_begin * kc, widen);
+		});
+	}
+
+	template<bool TransA, bool TransB, typename T, typename S, typename Widen>
+	static void gemm_impl(size_t m, size_t n, size_t k, const T* A, size_t lda, const S* B, size_t ldb, T* C, size_t ldc, bool accumulate, const Epilogue<T>& epilogue, const Widen& widen) {
+
+		const Blocking& b = blocking<T>();
+		const size_t NR = KERNELS::get<T>().tiles[b.tile].nr;
+		const size_t nc_max = std::min(b.nc, (n + NR - 1) / NR * NR);
+		T* B_packed = packing_buffer<T>(b.kc * nc_max, 1);
+
+		gemm_driver<TransA>(m, n, k, A, lda, C, ldc, accumulate, epilogue, b, [&](size_t pc, size_t jc, size_t kc, size_t nc) {
+			pack_B_parallel<TransB>(NR, kc, nc, TransB ? B + jc * ldb + pc : B + pc * ldb + jc, ldb, B_packed, widen);
+			return static_cast<const T*>(B_packed);
+		});
+	}
+
+
+	// ======== PRE-PACKED B ======== //
+	// Same block order as gemm_driver: the (pc, jc) block starts after jc full-height column blocks
+	// (nc is a multiple of NR, so they hold exactly jc * k elements) and pc rows of its own block.
+	template<typename T>
+	void PackedB<T>::pack(size_t k, size_t n, const T* B, size_t ldb) {
+		_k = k;
+		_n = n;
+		_blocking = GEMM::blocking<T>();
+		_nr = KERNELS::get<T>().tiles[_blocking.tile].nr;
+		_panels.resize(k * ((n + _nr - 1) / _nr * _nr));
+
+		for (size_t jc = 0; jc < n; jc += _blocking.nc) {
+			const size_t nc = std::min(_blocking.nc, n - jc);
+			for (size_t pc = 0; pc < k; pc += _blocking.kc)
+				pack_B_parallel<false>(_nr, std::min(_blocking.kc, k - pc), nc, B + pc * ldb + jc, ldb, _panels.data() + block_offset(pc, jc), [](T b) { return b; });
+		}
+	}
+
+	template<typename T>
+	size_t PackedB<T>::block_offset(size_t pc, size_t jc) const {
+		const size_t nc = std::min(_blocking.nc, _n - jc);
+		return jc * _k + pc * ((nc + _nr - 1) / _nr * _nr);
+	}
+
+	template<typename T>
+	void gemm(size_t m, const T* A, size_t lda, const PackedB<T>& B, T* C, size_t ldc, bool accumulate, const Epilogue<T>& epilogue) {
+		gemm_driver<false>(m, B.cols(), B.rows(), A, lda, C, ldc, accumulate, epilogue, B.blocking(), [&](size_t pc, size_t jc, size_t, size_t) {
+			return B.data() + B.block_offset(pc, jc);
+		});
+	}
+
+	template<typename T>
+	void gemm(size_t m, size_t n, size_t k, const T* A, size_t lda, const T* B, size_t ldb, T* C, size_t ldc, bool accumulate, const Epilogue<T>& epilogue) {
+		gemm_impl<false, false>(m, n, k, A, lda, B, ldb, C, ldc, accumulate, epilogue, [](T b) { return b; });
+	}
+
+	template<typename T>
+	void gemm(size_t m, size_t n, size_t k, const T* A, size_t lda, const uint16_t* B, size_t ldb, WeightFormat format, T* C, size_t ldc, bool accumulate, const Epilogue<T>& epilogue) {
+		if (format == WeightFormat::BF16)
+			gemm_impl<false, false>(m, n, k, A, lda, B, ldb, C, ldc, accumulate, epilogue, [](uint16_t b) { return T(HALF::from_bf16(b)); });
+		else
+			gemm_impl<false, false>(m, n, k, A, lda, B, ldb, C, ldc, accumulate, epilogue, [](uint16_t b) { return T(HALF::from_fp16(b)); });
+	}
+
+	template<typename T>
+	void gemm_tn(size_t m, size_t n, size_t k, const T* A, size_t lda, const T* B, size_t ldb, T* C, size_t ldc, bool accumulate, const Epilogue<T>& epilogue) {
+		gemm_impl<true, false>(m, n, k, A, lda, B, ldb, C, ldc, accumulate, epilogue, [](T b) { return b; });
+	}
+
+	template<typename T>
+	void gemm_nt(size_t m, size_t n, size_t k, const T* A, size_t lda, const T* B, size_t ldb, T* C, size_t ldc, bool accumulate, const Epilogue<T>& epilogue) {
+		gemm_impl<false, true>(m, n, k, A, lda, B, ldb, C, ldc, accumulate, epilogue, [](T b) { return b; });
+	}
+
+	template void gemm<float>(size_t, size_t, size_t, const float*, size_t, const float*, size_t, float*, size_t, bool, const Epilogue<float>&);
+	template void gemm<double>(size_t, size_t, size_t, const double*, size_t, const double*, size_t, double*, size_t, bool, const Epilogue<double>&);
+	template void gemm<float>(size_t, size_t, size_t, const float*, size_t, const uint16_t*, size_t, WeightFormat, float*, size_t, bool, const Epilogue<float>&);
+	template void gemm<double>(size_t, size_t, size_t, const double*, size_t, const uint16_t*, size_t, WeightFormat, double*, size_t, bool, const Epilogue<double>&);
+	template const Blocking& blocking<float>();
+	template const Blocking& blocking<double>();
+	template void set_blocking<float>(Blocking);
+	template void set_blocking<double>(Blocking);
+	template class PackedB<float>;
+	template class PackedB<double>;
+	template void gemm<float>(size_t, const float*, size_t, const PackedB<float>&, float*, size_t, bool, const Epilogue<float>&);
+	template void gemm<double>(size_t, const double*, size_t, const PackedB<double>&, double*, size_t, bool, const Epilogue<double>&);
+	template void gemm_tn<float>(size_t, size_t, size_t, const float*, size_t, const float*, size_t, float*, size_t, bool, const Epilogue<float>&);
+	template void gemm_tn<double>(size_t, size_t, size_t, const double*, size_t, const double*, size_t, double*, size_t, bool, const Epilogue<double>&);
+	template void gemm_nt<float>(size_t, size_t, size_t, const float*, size_t, const float*, size_t, float*, size_t, bool, const Epilogue<float>&);
+	template void gemm_nt<double>(size_t, size_t, size_t, const double*, size_t, const double*, size_t, double*, size_t, bool, const Epilogue<double>&);
+}
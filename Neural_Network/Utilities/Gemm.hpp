@@ -0,0 +1,131 @@
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "HalfPrecision.hpp"
+#include "AlignedAllocator.hpp"
+
+
+#ifndef GEMM_HPP
+#define GEMM_HPP
+
+
+// ======== GEMM ENGINE ======== //
+// C = A * B (+ C if accumulate), all row-major with leading dimensions, then an optional bias + ReLU epilogue.
+// Goto-style blocking: B is packed into KC x NC panels (L3), A into MC x KC blocks (L2),
+// and a MR x NR register tile is computed by the microkernel out of L1.
+// MR and NR come from the register tile of the SIMD kernel table picked at runtime (see Kernels.hpp).
+// MC, KC, NC are the defaults: the blocking in use can be changed at runtime, or autotuned.
+namespace GEMM {
+
+	// Applied to C on the last K block, while each tile is still in registers: C = relu(C + bias)
+	template<typename T>
+	struct Epilogue {
+		const T* bias = nullptr;
+		bool relu = false;
+	};
+
+	constexpr size_t MC = 96;
+	constexpr size_t KC = 256;
+	constexpr size_t NC = 4096;
+
+	// Block sizes and register tile the engine runs with. tile indexes KERNELS::Table::tiles;
+	// mc and nc are rounded down to multiples of its mr and nr when set.
+	struct Blocking {
+		size_t mc = MC;
+		size_t kc = KC;
+		size_t nc = NC;
+		size_t tile = 0;
+	};
+
+	template<typename T> const Blocking& blocking();
+	// Used by the next calls. Not meant to be called while another thread computes.
+	template<typename T> void set_blocking(Blocking b);
+
+	template<typename T>
+	void gemm(size_t m, size_t n, size_t k,
+			  const T* A, size_t lda,
+			  const T* B, size_t ldb,
+			  T* C, size_t ldc,
+			  bool accumulate = false, const Epilogue<T>& epilogue = {});
+
+	// Same, with B stored as bf16 / fp16: widened to T while packing, accumulated in T
+	template<typename T>
+	void gemm(size_t m, size_t n, size_t k,
+			  const T* A, size_t lda,
+			  const uint16_t* B, size_t ldb, WeightFormat format,
+			  T* C, size_t ldc,
+			  bool accumulate = false, const Epilogue<T>& epilogue = {});
+
+	// B (k x n) packed once into the NR-column panels gemm() would otherwise rebuild on every call.
+	// For weights that are reused across many calls: repack whenever B changes.
+	// The blocking in use when packing is kept: products with B always run with it.
+	template<typename T>
+	class PackedB {
+	private:
+		size_t _k = 0;
+		size_t _n = 0;
+		size_t _nr = 0;
+		Blocking _blocking;
+		MEMORY::aligned_vector<T> _panels;
+
+	public:
+		void pack(size_t k, size_t n, const T* B, size_t ldb);
+		inline void clear() { _k = _n = 0; _panels = MEMORY::aligned_vector<T>(); };
+		inline bool empty() const { return _panels.empty(); };
+
+		inline size_t rows() const { return _k; };
+		inline size_t cols() const { return _n; };
+		inline size_t nr() const { return _nr; };
+		inline const Blocking& blocking() const { return _blocking; };
+		inline const T* data() const { return _panels.data(); };
+		size_t block_offset(size_t pc, size_t jc) const;
+	};
+
+	// Same as gemm(), with B already packed: its panels are streamed as they are
+	template<typename T>
+	void gemm(size_t m,
+			  const T* A, size_t lda,
+			  const PackedB<T>& B,
+			  T* C, size_t ldc,
+			  bool accumulate = false, const Epilogue<T>& epilogue = {});
+
+	// C = A^T * B, with A stored k x m (lda >= m). Nothing is transposed in memory: A is read transposed while packing.
+	template<typename T>
+	void gemm_tn(size_t m, size_t n, size_t k,
+				 const T* A, size_t lda,
+				 const T* B, size_t ldb,
+				 T* C, size_t ldc,
+				 bool accumulate = false, const Epilogue<T>& epilogue = {});
+
+	// C = A * B^T, with B stored n x k (ldb >= k). Same, B is read transposed while packing.
+	template<typename T>
+	void gemm_nt(size_t m, size_t n, size_t k,
+				 const T* A, size_t lda,
+				 const T* B, size_t ldb,
+				 T* C, size_t ldc,
+				 bool accumulate = false, const Epilogue<T>& epilogue = {});
+
+
+	// ======== AUTOTUNING ======== //
+	// One product of the workload to tune for: C (m x n) = op(A) * op(B) over k, with B pre-packed if packed_b
+	struct Shape {
+		size_t m;
+		size_t n;
+		size_t k;
+		bool trans_a = false;
+		bool trans_b = false;
+		bool packed_b = false;
+	};
+
+	// CPUID brand string, e.g. "AMD EPYC 7763 64-Core Processor"
+	std::string cpu_model();
+
+	// Sets (and returns) the fastest blocking for these shapes on this CPU. The result is looked up in cache_file
+	// first, keyed by CPU model, kernel table, scalar type, thread count and shapes. On a miss every register tile is timed,
+	// then KC, MC and NC one after the other, and the winner is appended to the file.
+	template<typename T>
+	Blocking autotune(const std::vector<Shape>& shapes, const std::string& cache_file);
+}
+
+#endif
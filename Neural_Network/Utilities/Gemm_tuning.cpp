@@ -0,0 +1,192 @@
+#include "Gemm.hpp"
+
+#include "Kernels.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#endif
+
+
+namespace GEMM {
+
+	// ======== CPU MODEL ======== //
+	std::string cpu_model() {
+		std::string model;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+		unsigned int regs[12] = {};
+		if (__get_cpuid_max(0x80000000, nullptr) >= 0x80000004) {
+			for (unsigned int leaf = 0; leaf < 3; leaf++)
+				__get_cpuid(0x80000002 + leaf, &regs[4 * leaf], &regs[4 * leaf + 1], &regs[4 * leaf + 2], &regs[4 * leaf + 3]);
+			model.assign(reinterpret_cast<const char*>(regs), sizeof(regs));
+			model.resize(model.find('\0') == std::string::npos ? model.size() : model.find('\0'));
+		}
+#endif
+		const size_t first = model.find_first_not_of(' ');
+		if (first == std::string::npos)
+			return "unknown";
+		return model.substr(first, model.find_last_not_of(' ') - first + 1);
+	}
+
+
+	// ======== TIMING ======== //
+	// Operands of one shape, filled once and reused by every candidate
+	template<typename T>
+	struct Workload {
+		Shape shape;
+		MEMORY::aligned_vector<T> A;
+		MEMORY::aligned_vector<T> B;
+		MEMORY::aligned_vector<T> C;
+		PackedB<T> packed;
+	};
+
+	// Best of a few runs of every shape, summed, in seconds. PackedB operands are repacked with the candidate first.
+	template<typename T>
+	static double time_blocking(std::vector<Workload<T>>& workloads, const Blocking& candidate) {
+		set_blocking<T>(candidate);
+		constexpr int repeats = 10;
+
+		double total = 0.0;
+		for (Workload<T>& w : workloads) {
+			const Shape& s = w.shape;
+			if (s.packed_b)
+				w.packed.pack(s.k, s.n, w.B.data(), s.n);
+
+			double best = 1e30;
+			for (int r = 0; r <= repeats; r++) {
+				const auto start = std::chrono::steady_clock::now();
+				if (s.packed_b)
+					gemm(s.m, w.A.data(), s.k, w.packed, w.C.data(), s.n);
+				else if (s.trans_a)
+					gemm_tn(s.m, s.n, s.k, w.A.data(), s.m, w.B.data(), s.n, w.C.data(), s.n);
+				else if (s.trans_b)
+					gemm_nt(s.m, s.n, s.k, w.A.data(), s.k, w.B.data(), s.k, w.C.data(), s.n);
+				else
+					gemm(s.m, s.n, s.k, w.A.data(), s.k, w.B.data(), s.n, w.C.data(), s.n);
+				const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				if (r > 0) // the first run warms the caches and the packing buffers
+					best = std::min(best, seconds);
+			}
+			total += best;
+		}
+		return total;
+	}
+
+
+	// ======== CACHE FILE ======== //
+	// One line per tuned configuration, tab separated:
+	// cpu model, kernel table, scalar type, thread count, shapes, then "mr nr unroll mc kc nc"
+	template<typename T>
+	static std::string cache_key(const std::vector<Shape>& shapes) {
+		std::ostringstream key;
+		key << cpu_model() << '\t' << KERNELS::get<T>().name << '\t' << (std::is_same<T, float>::value ? "float" : "double") << '\t'
+			<< THREADS::threads() << " threads" << '\t';
+		for (size_t i = 0; i < shapes.size(); i++)
+			key << (i ? " " : "") << shapes[i].m << 'x' << shapes[i].n << 'x' << shapes[i].k
+				<< (shapes[i].trans_a ? "t" : "") << (shapes[i].trans_b ? "T" : "") << (shapes[i].packed_b ? "p" : "");
+		return key.str();
+	}
+
+	// The cached tile is found back by shape, so the file survives a change in the order of the tiles
+	template<typename T>
+	static bool load_cached(const std::string& key, const std::string& cache_file, Blocking& result) {
+		std::ifstream file(cache_file);
+		std::string line;
+		while (std::getline(file, line)) {
+			const size_t split = line.rfind('\t');
+			if (split == std::string::npos || line.compare(0, split, key) != 0 || split != key.size())
+				continue;
+
+			size_t mr, nr, unroll;
+			Blocking b;
+			std::istringstream values(line.substr(split + 1));
+			if (!(values >> mr >> nr >> unroll >> b.mc >> b.kc >> b.nc))
+				continue;
+			const KERNELS::Table<T>& kernels = KERNELS::get<T>();
+			for (size_t t = 0; t < kernels.n_tiles; t++)
+				if (kernels.tiles[t].mr == mr && kernels.tiles[t].nr == nr && kernels.tiles[t].unroll == unroll) {
+					b.tile = t;
+					result = b;
+					return true;
+				}
+		}
+		return false;
+	}
+
+
+	// ======== AUTOTUNER ======== //
+	template<typename T>
+	Blocking autotune(const std::vector<Shape>& shapes, const std::string& cache_file) {
+		const std::string key = cache_key<T>(shapes);
+		Blocking best;
+		if (load_cached<T>(key, cache_file, best)) {
+			set_blocking<T>(best);
+			return blocking<T>();
+		}
+
+		std::vector<Workload<T>> workloads(shapes.size());
+		for (size_t i = 0; i < shapes.size(); i++) {
+			Workload<T>& w = workloads[i];
+			w.shape = shapes[i];
+			w.A.resize(shapes[i].m * shapes[i].k);
+			w.B.resize(shapes[i].k * shapes[i].n);
+			w.C.resize(shapes[i].m * shapes[i].n);
+			for (size_t j = 0; j < w.A.size(); j++) w.A[j] = T((j * 37 % 101) / 101.0 - 0.5);
+			for (size_t j = 0; j < w.B.size(); j++) w.B[j] = T((j * 53 % 97) / 97.0 - 0.5);
+		}
+
+		// One coordinate at a time, starting from the defaults: the register tile, then KC, MC and NC.
+		// A candidate has to win by 2% so timing noise doesn't move the blocking around.
+		double best_time = time_blocking(workloads, best);
+		const auto try_candidate = [&](Blocking candidate) {
+			const double seconds = time_blocking(workloads, candidate);
+			if (seconds < 0.98 * best_time) {
+				best_time = seconds;
+				best = blocking<T>();
+			}
+		};
+
+		const KERNELS::Table<T>& kernels = KERNELS::get<T>();
+		const Blocking start = best;
+		for (size_t t = 1; t < kernels.n_tiles; t++) {
+			Blocking candidate = start;
+			candidate.tile = t;
+			try_candidate(candidate);
+		}
+		for (size_t kc : { 128, 192, 256, 384, 512 }) {
+			Blocking candidate = best;
+			candidate.kc = kc;
+			try_candidate(candidate);
+		}
+		for (size_t mc : { 48, 72, 96, 144, 192 }) {
+			Blocking candidate = best;
+			candidate.mc = mc;
+			try_candidate(candidate);
+		}
+		for (size_t nc : { 512, 1024, 2048, 4096 }) {
+			Blocking candidate = best;
+			candidate.nc = nc;
+			try_candidate(candidate);
+		}
+		set_blocking<T>(best);
+
+		std::ofstream file(cache_file, std::ios::app);
+		if (!file) {
+			std::cerr << "Error opening file for writing: " << cache_file << std::endl;
+			return blocking<T>();
+		}
+		const typename KERNELS::Table<T>::Tile& tile = kernels.tiles[best.tile];
+		file << key << '\t' << tile.mr << ' ' << tile.nr << ' ' << tile.unroll << ' ' << best.mc << ' ' << best.kc << ' ' << best.nc << '\n';
+		return blocking<T>();
+	}
+
+	template Blocking autotune<float>(const std::vector<Shape>&, const std::string&);
+	template Blocking autotune<double>(const std::vector<Shape>&, const std::string&);
+}
@@ -0,0 +1,44 @@
+#include "Matrix.hpp"
+#include "HalfPrecision.hpp"
+
+
+#ifndef HALF_MATRIX_HPP
+#define HALF_MATRIX_HPP
+
+
+// ======== HALF MATRIX ======== //
+// Row-major bf16 / fp16 copy of a Matrix, for inference-only weight storage.
+class HalfMatrix {
+private:
+	size_t _rows = 0;
+	size_t _cols = 0;
+	WeightFormat _format = WeightFormat::BF16;
+
+	MEMORY::aligned_vector<uint16_t> _matrix;
+
+public:
+	inline HalfMatrix() {};
+	template<typename T>
+	HalfMatrix(const BasicMatrix<T>& A, WeightFormat format) : _rows(A.rows()), _cols(A.cols()), _format(format), _matrix(A.rows() * A.cols()) {
+		assert(format != WeightFormat::Full);
+		for (size_t idx = 0; idx < _rows * _cols; idx++)
+			_matrix[idx] = HALF::narrow(static_cast<float>(A(idx)), format);
+	};
+
+	size_t rows() const { return _rows; };
+	size_t cols() const { return _cols; };
+	WeightFormat format() const { return _format; };
+
+	inline const uint16_t* data() const { return _matrix.data(); };
+	inline float operator()(size_t i, size_t j) const { return HALF::widen(_matrix[i * _cols + j], _format); };
+
+	template<typename T>
+	BasicMatrix<T> widen() const {
+		BasicMatrix<T> A(_rows, _cols);
+		for (size_t idx = 0; idx < _rows * _cols; idx++)
+			A(idx) = HALF::widen(_matrix[idx], _format);
+		return A;
+	};
+};
+
+#endif
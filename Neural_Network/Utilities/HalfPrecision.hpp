@@ -0,0 +1,91 @@
+#include <cstdint>
+#include <cstring>
+
+
+#ifndef HALF_PRECISION_HPP
+#define HALF_PRECISION_HPP
+
+
+// ======== 16-BIT FLOATS ======== //
+// Storage-only formats: values are widened before any arithmetic. Conversions round to nearest even.
+// INT8 weights are calibrated rather than converted, see QuantizedMatrix.hpp, and pruned weights
+// are stored block-sparse, see SparseMatrix.hpp.
+enum class WeightFormat { Full, BF16, FP16, INT8, Sparse };
+
+namespace HALF {
+
+	inline uint32_t bits_of(float f) { uint32_t b; std::memcpy(&b, &f, sizeof(b)); return b; }
+	inline float float_of(uint32_t b) { float f; std::memcpy(&f, &b, sizeof(f)); return f; }
+
+	// bfloat16: the top half of a float32
+	inline uint16_t to_bf16(float f) {
+		uint32_t bits = bits_of(f);
+		if ((bits & 0x7fffffff) > 0x7f800000)
+			return static_cast<uint16_t>((bits >> 16) | 0x40); // quiet NaN
+		bits += 0x7fff + ((bits >> 16) & 1);
+		return static_cast<uint16_t>(bits >> 16);
+	}
+	inline float from_bf16(uint16_t h) {
+		return float_of(static_cast<uint32_t>(h) << 16);
+	}
+
+	// IEEE half: 1 sign, 5 exponent, 10 mantissa bits
+	inline uint16_t to_fp16(float f) {
+		const uint32_t bits = bits_of(f);
+		const uint32_t sign = (bits >> 16) & 0x8000;
+		const int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xff) - 127 + 15;
+		uint32_t mantissa = bits & 0x7fffff;
+
+		if ((bits & 0x7fffffff) > 0x7f800000)
+			return static_cast<uint16_t>(sign | 0x7e00);
+		if (exponent >= 31)
+			return static_cast<uint16_t>(sign | 0x7c00);
+
+		if (exponent <= 0) { // subnormal half, or zero
+			if (exponent < -10)
+				return static_cast<uint16_t>(sign);
+			mantissa |= 0x800000;
+			const uint32_t shift = static_cast<uint32_t>(14 - exponent);
+			uint32_t half = mantissa >> shift;
+			const uint32_t rest = mantissa & ((1u << shift) - 1);
+			const uint32_t middle = 1u << (shift - 1);
+			if (rest > middle || (rest == middle && (half & 1)))
+				half++;
+			return static_cast<uint16_t>(sign | half);
+		}
+
+		uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+		const uint32_t rest = mantissa & 0x1fff;
+		if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+			half++; // a carry into the exponent is the correct rounding
+		return static_cast<uint16_t>(half);
+	}
+	inline float from_fp16(uint16_t h) {
+		const uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+		uint32_t exponent = (h >> 10) & 0x1f;
+		uint32_t mantissa = h & 0x3ff;
+
+		if (exponent == 0) {
+			if (mantissa == 0)
+				return float_of(sign);
+			exponent = 127 - 15 + 1;
+			while (!(mantissa & 0x400)) {
+				mantissa <<= 1;
+				exponent--;
+			}
+			return float_of(sign | (exponent << 23) | ((mantissa & 0x3ff) << 13));
+		}
+		if (exponent == 31)
+			return float_of(sign | 0x7f800000 | (mantissa << 13));
+		return float_of(sign | ((exponent + 127 - 15) << 23) | (mantissa << 13));
+	}
+
+	inline uint16_t narrow(float f, WeightFormat format) {
+		return format == WeightFormat::BF16 ? to_bf16(f) : to_fp16(f);
+	}
+	inline float widen(uint16_t h, WeightFormat format) {
+		return format == WeightFormat::BF16 ? from_bf16(h) : from_fp16(h);
+	}
+}
+
+#endif
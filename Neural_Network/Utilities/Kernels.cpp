@@ -0,0 +1,109 @@
+#include "Kernels.hpp"
+#include "Kernels_impl.hpp"
+
+#include <cmath>
+#include <type_traits>
+
+
+namespace KERNELS {
+
+	// ======== GENERIC KERNELS ======== //
+	// Plain scalar "vector" of width 1, so the portable path shares the SIMD templates
+	template<typename T>
+	struct Scalar {
+		using scalar = T;
+		using reg = T;
+		static constexpr size_t width = 1;
+
+		static inline reg zero() { return T(0); }
+		static inline reg load(const T* p) { return *p; }
+		static inline void store(T* p, reg v) { *p = v; }
+		static inline reg broadcast(const T* p) { return *p; }
+		static inline reg fmadd(reg a, reg b, reg c) { return a * b + c; }
+		static inline reg add(reg a, reg b) { return a + b; }
+		static inline reg relu(reg v) { return v > T(0) ? v : T(0); }
+		static inline reg relu_mask(reg y, reg mask) { return mask > T(0) ? y : T(0); }
+		static inline reg sub(reg a, reg b) { return a - b; }
+		static inline reg mul(reg a, reg b) { return a * b; }
+		static inline reg div(reg a, reg b) { return a / b; }
+		static inline reg min(reg a, reg b) { return a < b ? a : b; }
+		static inline reg max(reg a, reg b) { return a > b ? a : b; }
+		static inline reg round(reg v) { return std::nearbyint(v); }
+		static inline reg pow2(reg n) { return std::ldexp(T(1), static_cast<int>(n)); } // n integral
+		static inline reg exponent(reg v) { return T(std::ilogb(v)); } // floor(log2(v)), v > 0
+	};
+
+
+	static void generic_gemm_u8s8(size_t m, size_t n, size_t k, const uint8_t* X, const int8_t* W, int32_t* C) {
+		for (size_t i = 0; i < m; i++) {
+			int32_t* C_row = C + i * n;
+			for (size_t j = 0; j < n; j++)
+				C_row[j] = 0;
+			for (size_t p = 0; p < k; p += 4) {
+				const uint8_t* x = X + i * k + p;
+				const int8_t* W_group = W + p * n;
+				for (size_t j = 0; j < n; j++)
+					for (size_t q = 0; q < 4; q++)
+						C_row[j] += static_cast<int32_t>(x[q]) * W_group[4 * j + q];
+			}
+		}
+	}
+
+
+	// ======== DISPATCH ======== //
+	static ISA detect() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f"))
+			return ISA::AVX512;
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+			return ISA::AVX2;
+		if (__builtin_cpu_supports("sse4.2"))
+			return ISA::SSE42;
+#endif
+		return ISA::Generic;
+	}
+
+	template<typename T>
+	Table<T> table_for(ISA isa) {
+		constexpr bool is_float = std::is_same<T, float>::value;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+		switch (isa) {
+		case ISA::AVX512:
+			if constexpr (is_float) return avx512_table_float(); else return avx512_table_double();
+		case ISA::AVX2:
+			if constexpr (is_float) return avx2_table_float(); else return avx2_table_double();
+		case ISA::SSE42:
+			if constexpr (is_float) return sse42_table_float(); else return sse42_table_double();
+		case ISA::Generic:
+			break;
+		}
+#endif
+		return make_table<Scalar<T>, 4, 8, TileShape<4, 4>, TileShape<2, 8>>(ISA::Generic, "generic");
+	}
+
+	template<typename T>
+	const Table<T>& get() {
+		static const Table<T> table = table_for<T>(detect());
+		return table;
+	}
+
+	const QuantTable& get_quant() {
+		static const QuantTable table = []() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx512vnni") && __builtin_cpu_supports("avx512bw"))
+				return vnni_quant_table();
+			if (__builtin_cpu_supports("avx2"))
+				return avx2_quant_table();
+#endif
+			return QuantTable{ "generic", generic_gemm_u8s8 };
+		}();
+		return table;
+	}
+
+	template Table<float> table_for<float>(ISA);
+	template Table<double> table_for<double>(ISA);
+	template const Table<float>& get<float>();
+	template const Table<double>& get<double>();
+}
@@ -0,0 +1,93 @@
+#include <cstddef>
+#include <cstdint>
+
+
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+
+
+// ======== SIMD KERNELS ======== //
+// One binary, several instruction sets: the best kernel table for the running CPU
+// is picked once (CPUID) the first time it is requested, for float and for double.
+namespace KERNELS {
+
+	enum class ISA { Generic, SSE42, AVX2, AVX512 };
+
+	// Block-sparse weights (see SparseMatrix.hpp) are stored in runs of this many columns:
+	// a multiple of every vector width, so each block is a whole number of registers
+	constexpr size_t sparse_block = 16;
+
+	template<typename T>
+	struct Table {
+		// MR x NR register tile: C(mr x nr) (+)= packed A panel * packed B panel,
+		// then the epilogue while the tile is still in registers: + bias[j] (if non null), ReLU (if relu)
+		using microkernel_fn = void (*)(size_t kc, const T* A, const T* B, T* C, size_t ldc, size_t mr, size_t nr, bool accumulate, const T* bias, bool relu);
+		// y += x
+		using axpy_fn = void (*)(size_t n, const T* x, T* y);
+		// y *= (mask > 0), i.e. the ReLU derivative applied in place
+		using relu_mask_fn = void (*)(size_t n, T* y, const T* mask);
+		// Sparse row times dense matrix: y(n) = sum_p values[p] * W[index[p]][0:n] (+ bias, ReLU as above),
+		// W row-major with leading dimension ldw. Only the weight rows of non-zero inputs are read.
+		using sparse_row_fn = void (*)(size_t nnz, const T* values, const uint32_t* index, const T* W, size_t ldw, size_t n, T* y, const T* bias, bool relu);
+		// Dense row times block-sparse matrix: y(n) = x(k) * W (+ bias, ReLU as above). Row p of W holds the blocks
+		// row_start[p] to row_start[p + 1], block b covering the sparse_block columns from block_col[b] * sparse_block.
+		// Zero inputs are skipped. acc is scratch for n rounded up to sparse_block.
+		using block_sparse_row_fn = void (*)(size_t k, size_t n, const T* x, const uint32_t* row_start, const uint32_t* block_col, const T* blocks, T* acc, T* y, const T* bias, bool relu);
+		// y = softmax(x) over one row, y may be x. Returns the sum of exp(x - max) and stores the max and its first index
+		// where not null, so log-sum-exp is max + log(sum). exp and log are polynomial approximations, see Kernels_impl.hpp.
+		using softmax_row_fn = T (*)(size_t n, const T* x, T* y, T* row_max, size_t* argmax);
+		// y = log(x) for x > 0, y may be x
+		using log_row_fn = void (*)(size_t n, const T* x, T* y);
+
+		// Register tiles built for this ISA, for the GEMM autotuner (see GEMM::autotune). tiles[0] is mr x nr / microkernel.
+		// unroll: how many k steps the microkernel's inner loop is unrolled by.
+		struct Tile {
+			size_t mr;
+			size_t nr;
+			size_t unroll;
+			microkernel_fn microkernel;
+		};
+		static constexpr size_t max_tiles = 6;
+
+		ISA isa;
+		const char* name;
+		size_t mr;
+		size_t nr;
+		microkernel_fn microkernel;
+		axpy_fn axpy;
+		relu_mask_fn relu_mask;
+		sparse_row_fn sparse_row;
+		block_sparse_row_fn block_sparse_row;
+		softmax_row_fn softmax_row;
+		log_row_fn log_row;
+		Tile tiles[max_tiles];
+		size_t n_tiles;
+	};
+
+	// Quantized inference: C(m x n) = X(m x k) * W(k x n), X in uint8 [0, 127], W in int8, C in int32.
+	// W is packed as k/4 groups of n columns of 4 consecutive k values, so one 32-bit broadcast of X
+	// feeds a whole vector of columns. k must be a multiple of 4 and n of 16 (zero padded).
+	// Keeping X on 7 bits lets vpmaddubsw never saturate.
+	struct QuantTable {
+		using gemm_u8s8_fn = void (*)(size_t m, size_t n, size_t k, const uint8_t* X, const int8_t* W, int32_t* C);
+
+		const char* name;
+		gemm_u8s8_fn gemm_u8s8;
+	};
+
+	template<typename T> const Table<T>& get();
+	const QuantTable& get_quant();
+	template<typename T> Table<T> table_for(ISA isa);
+
+	// One translation unit per instruction set (Kernels_<isa>.cpp), each built with its own #pragma GCC target
+	Table<float> sse42_table_float();
+	Table<double> sse42_table_double();
+	Table<float> avx2_table_float();
+	Table<double> avx2_table_double();
+	Table<float> avx512_table_float();
+	Table<double> avx512_table_double();
+	QuantTable avx2_quant_table();
+	QuantTable vnni_quant_table();
+}
+
+#endif
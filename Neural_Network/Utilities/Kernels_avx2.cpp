@@ -0,0 +1,119 @@
+#include "Kernels.hpp"
+
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+
+#pragma GCC target("avx2,fma")
+#include "Kernels_impl.hpp"
+
+
+namespace KERNELS {
+
+	// ======== AVX2 + FMA VECTORS ======== //
+	struct AVX2_float {
+		using scalar = float;
+		using reg = __m256;
+		static constexpr size_t width = 8;
+
+		static inline reg zero() { return _mm256_setzero_ps(); }
+		static inline reg load(const float* p) { return _mm256_loadu_ps(p); }
+		static inline void store(float* p, reg v) { _mm256_storeu_ps(p, v); }
+		static inline reg broadcast(const float* p) { return _mm256_broadcast_ss(p); }
+		static inline reg fmadd(reg a, reg b, reg c) { return _mm256_fmadd_ps(a, b, c); }
+		static inline reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+		static inline reg relu(reg v) { return _mm256_max_ps(v, _mm256_setzero_ps()); }
+		static inline reg relu_mask(reg y, reg mask) { return _mm256_and_ps(y, _mm256_cmp_ps(mask, _mm256_setzero_ps(), _CMP_GT_OQ)); }
+		static inline reg sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+		static inline reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+		static inline reg div(reg a, reg b) { return _mm256_div_ps(a, b); }
+		static inline reg min(reg a, reg b) { return _mm256_min_ps(a, b); }
+		static inline reg max(reg a, reg b) { return _mm256_max_ps(a, b); }
+		static inline reg round(reg v) { return _mm256_round_ps(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		static inline reg pow2(reg n) { return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23)); }
+		static inline reg exponent(reg v) { return _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(_mm256_castps_si256(v), 23), _mm256_set1_epi32(127))); }
+	};
+
+	struct AVX2_double {
+		using scalar = double;
+		using reg = __m256d;
+		static constexpr size_t width = 4;
+
+		static inline reg zero() { return _mm256_setzero_pd(); }
+		static inline reg load(const double* p) { return _mm256_loadu_pd(p); }
+		static inline void store(double* p, reg v) { _mm256_storeu_pd(p, v); }
+		static inline reg broadcast(const double* p) { return _mm256_broadcast_sd(p); }
+		static inline reg fmadd(reg a, reg b, reg c) { return _mm256_fmadd_pd(a, b, c); }
+		static inline reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+		static inline reg relu(reg v) { return _mm256_max_pd(v, _mm256_setzero_pd()); }
+		static inline reg relu_mask(reg y, reg mask) { return _mm256_and_pd(y, _mm256_cmp_pd(mask, _mm256_setzero_pd(), _CMP_GT_OQ)); }
+		static inline reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+		static inline reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+		static inline reg div(reg a, reg b) { return _mm256_div_pd(a, b); }
+		static inline reg min(reg a, reg b) { return _mm256_min_pd(a, b); }
+		static inline reg max(reg a, reg b) { return _mm256_max_pd(a, b); }
+		static inline reg round(reg v) { return _mm256_round_pd(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		static inline reg pow2(reg n) { return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(_mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n)), _mm256_set1_epi64x(1023)), 52)); }
+		static inline reg exponent(reg v) {
+			const __m256i biased = _mm256_srli_epi64(_mm256_castpd_si256(v), 52);
+			return _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(biased, _mm256_castpd_si256(_mm256_set1_pd(4503599627370496.0)))), _mm256_set1_pd(4503599627370496.0 + 1023.0));
+		}
+	};
+
+	Table<float> avx2_table_float() { return make_table<AVX2_float, 6, 16, TileShape<4, 24>, TileShape<8, 8>, TileShape<4, 24, 4>>(ISA::AVX2, "avx2+fma"); }
+	Table<double> avx2_table_double() { return make_table<AVX2_double, 6, 8, TileShape<4, 12>, TileShape<8, 4>, TileShape<4, 12, 4>>(ISA::AVX2, "avx2+fma"); }
+
+
+	// ======== INT8 : vpmaddubsw, 4 x 16 ======== //
+	static inline __m256i broadcast_u8x4(const uint8_t* x) {
+		int32_t quad;
+		std::memcpy(&quad, x, sizeof(quad));
+		return _mm256_set1_epi32(quad);
+	}
+
+	// u8 x s8 pairs -> s16 (exact for u8 <= 127), then pairs of s16 -> s32
+	static inline __m256i dot4(__m256i acc, __m256i x, __m256i w, __m256i ones) {
+		return _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones));
+	}
+
+	static void avx2_gemm_u8s8(size_t m, size_t n, size_t k, const uint8_t* X, const int8_t* W, int32_t* C) {
+		constexpr size_t MR = 4;
+		const __m256i ones = _mm256_set1_epi16(1);
+
+		for (size_t i0 = 0; i0 < m; i0 += MR) {
+			const size_t mr = m - i0 < MR ? m - i0 : MR;
+			const uint8_t* x_row[MR];
+			for (size_t r = 0; r < MR; r++)
+				x_row[r] = X + (i0 + (r < mr ? r : mr - 1)) * k;
+
+			for (size_t j0 = 0; j0 < n; j0 += 16) {
+				__m256i c[MR][2];
+#pragma GCC unroll 4
+				for (size_t r = 0; r < MR; r++)
+					c[r][0] = c[r][1] = _mm256_setzero_si256();
+
+				const int8_t* W_panel = W + j0 * 4;
+				for (size_t p = 0; p < k; p += 4) {
+					const __m256i w0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(W_panel + p * n));
+					const __m256i w1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(W_panel + p * n + 32));
+#pragma GCC unroll 4
+					for (size_t r = 0; r < MR; r++) {
+						const __m256i x = broadcast_u8x4(x_row[r] + p);
+						c[r][0] = dot4(c[r][0], x, w0, ones);
+						c[r][1] = dot4(c[r][1], x, w1, ones);
+					}
+				}
+
+				for (size_t r = 0; r < mr; r++) {
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(C + (i0 + r) * n + j0), c[r][0]);
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(C + (i0 + r) * n + j0 + 8), c[r][1]);
+				}
+			}
+		}
+	}
+
+	QuantTable avx2_quant_table() { return QuantTable{ "avx2", avx2_gemm_u8s8 }; }
+}
+
+#endif
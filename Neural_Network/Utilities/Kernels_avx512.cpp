@@ -0,0 +1,63 @@
+#include "Kernels.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+
+#pragma GCC target("avx512f")
+#include "Kernels_impl.hpp"
+
+
+namespace KERNELS {
+
+	// ======== AVX-512 VECTORS ======== //
+	struct AVX512_float {
+		using scalar = float;
+		using reg = __m512;
+		static constexpr size_t width = 16;
+
+		static inline reg zero() { return _mm512_setzero_ps(); }
+		static inline reg load(const float* p) { return _mm512_loadu_ps(p); }
+		static inline void store(float* p, reg v) { _mm512_storeu_ps(p, v); }
+		static inline reg broadcast(const float* p) { return _mm512_set1_ps(*p); }
+		static inline reg fmadd(reg a, reg b, reg c) { return _mm512_fmadd_ps(a, b, c); }
+		static inline reg add(reg a, reg b) { return _mm512_add_ps(a, b); }
+		static inline reg relu(reg v) { return _mm512_max_ps(v, _mm512_setzero_ps()); }
+		static inline reg relu_mask(reg y, reg mask) { return _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(mask, _mm512_setzero_ps(), _CMP_GT_OQ), y); }
+		static inline reg sub(reg a, reg b) { return _mm512_sub_ps(a, b); }
+		static inline reg mul(reg a, reg b) { return _mm512_mul_ps(a, b); }
+		static inline reg div(reg a, reg b) { return _mm512_div_ps(a, b); }
+		static inline reg min(reg a, reg b) { return _mm512_min_ps(a, b); }
+		static inline reg max(reg a, reg b) { return _mm512_max_ps(a, b); }
+		static inline reg round(reg v) { return _mm512_roundscale_ps(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		static inline reg pow2(reg n) { return _mm512_scalef_ps(_mm512_set1_ps(1.f), n); }
+		static inline reg exponent(reg v) { return _mm512_getexp_ps(v); }
+	};
+
+	struct AVX512_double {
+		using scalar = double;
+		using reg = __m512d;
+		static constexpr size_t width = 8;
+
+		static inline reg zero() { return _mm512_setzero_pd(); }
+		static inline reg load(const double* p) { return _mm512_loadu_pd(p); }
+		static inline void store(double* p, reg v) { _mm512_storeu_pd(p, v); }
+		static inline reg broadcast(const double* p) { return _mm512_set1_pd(*p); }
+		static inline reg fmadd(reg a, reg b, reg c) { return _mm512_fmadd_pd(a, b, c); }
+		static inline reg add(reg a, reg b) { return _mm512_add_pd(a, b); }
+		static inline reg relu(reg v) { return _mm512_max_pd(v, _mm512_setzero_pd()); }
+		static inline reg relu_mask(reg y, reg mask) { return _mm512_maskz_mov_pd(_mm512_cmp_pd_mask(mask, _mm512_setzero_pd(), _CMP_GT_OQ), y); }
+		static inline reg sub(reg a, reg b) { return _mm512_sub_pd(a, b); }
+		static inline reg mul(reg a, reg b) { return _mm512_mul_pd(a, b); }
+		static inline reg div(reg a, reg b) { return _mm512_div_pd(a, b); }
+		static inline reg min(reg a, reg b) { return _mm512_min_pd(a, b); }
+		static inline reg max(reg a, reg b) { return _mm512_max_pd(a, b); }
+		static inline reg round(reg v) { return _mm512_roundscale_pd(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		static inline reg pow2(reg n) { return _mm512_scalef_pd(_mm512_set1_pd(1.0), n); }
+		static inline reg exponent(reg v) { return _mm512_getexp_pd(v); }
+	};
+
+	Table<float> avx512_table_float() { return make_table<AVX512_float, 8, 32, TileShape<12, 32>, TileShape<6, 48>, TileShape<12, 32, 4>>(ISA::AVX512, "avx512"); }
+	Table<double> avx512_table_double() { return make_table<AVX512_double, 8, 16, TileShape<12, 16>, TileShape<6, 24>, TileShape<12, 16, 4>>(ISA::AVX512, "avx512"); }
+}
+
+#endif
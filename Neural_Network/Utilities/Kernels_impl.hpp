@@ -0,0 +1,363 @@
+#include "Kernels.hpp"
+
+
+#ifndef KERNELS_IMPL_HPP
+#define KERNELS_IMPL_HPP
+
+
+// ======== KERNEL TEMPLATES ======== //
+// Written once against a small vector interface V (reg, width, load, store, broadcast, fmadd, relu, pow2, ...)
+// and instantiated by every Kernels_<isa>.cpp after its #pragma GCC target.
+// No standard headers in here: anything inline they define would be compiled for the wider ISA.
+namespace KERNELS {
+	namespace {
+
+		// One k step of the microkernel: c += A column (MR) x B row (NR)
+		template<typename V, size_t MR, size_t NR>
+		inline void rank1_update(typename V::reg (&c)[MR][NR / V::width], const typename V::scalar* A, const typename V::scalar* B) {
+			using R = typename V::reg;
+			constexpr size_t W = V::width;
+			constexpr size_t NV = NR / W;
+
+			R b[NV];
+#pragma GCC unroll 16
+			for (size_t v = 0; v < NV; v++)
+				b[v] = V::load(B + v * W);
+#pragma GCC unroll 16
+			for (size_t i = 0; i < MR; i++) {
+				const R a = V::broadcast(A + i);
+#pragma GCC unroll 16
+				for (size_t v = 0; v < NV; v++)
+					c[i][v] = V::fmadd(a, b[v], c[i][v]);
+			}
+		}
+
+		template<typename V, size_t MR, size_t NR, size_t U>
+		void microkernel(size_t kc, const typename V::scalar* A, const typename V::scalar* B, typename V::scalar* C, size_t ldc, size_t mr, size_t nr, bool accumulate, const typename V::scalar* bias, bool relu) {
+			using T = typename V::scalar;
+			using R = typename V::reg;
+			constexpr size_t W = V::width;
+			constexpr size_t NV = NR / W;
+			static_assert(NR % W == 0, "NR must be a multiple of the vector width");
+
+			R c[MR][NV];
+#pragma GCC unroll 16
+			for (size_t i = 0; i < MR; i++)
+#pragma GCC unroll 16
+				for (size_t v = 0; v < NV; v++)
+					c[i][v] = V::zero();
+
+			size_t p = 0;
+			for (; p + U <= kc; p += U) {
+#pragma GCC unroll 8
+				for (size_t u = 0; u < U; u++)
+					rank1_update<V, MR, NR>(c, A + u * MR, B + u * NR);
+				A += U * MR;
+				B += U * NR;
+			}
+			for (; p < kc; p++) {
+				rank1_update<V, MR, NR>(c, A, B);
+				A += MR;
+				B += NR;
+			}
+
+			// Full tile: epilogue in registers, straight to C
+			if (mr == MR && nr == NR) {
+				R b_bias[NV] = {};
+				if (bias)
+#pragma GCC unroll 16
+					for (size_t v = 0; v < NV; v++)
+						b_bias[v] = V::load(bias + v * W);
+#pragma GCC unroll 16
+				for (size_t i = 0; i < MR; i++) {
+					T* C_row = C + i * ldc;
+#pragma GCC unroll 16
+					for (size_t v = 0; v < NV; v++) {
+						R out = accumulate ? V::add(c[i][v], V::load(C_row + v * W)) : c[i][v];
+						if (bias) out = V::add(out, b_bias[v]);
+						if (relu) out = V::relu(out);
+						V::store(C_row + v * W, out);
+					}
+				}
+				return;
+			}
+
+			// Edge tile: spill, then write back the mr x nr valid part
+			T acc[MR][NR];
+#pragma GCC unroll 16
+			for (size_t i = 0; i < MR; i++)
+#pragma GCC unroll 16
+				for (size_t v = 0; v < NV; v++)
+					V::store(acc[i] + v * W, c[i][v]);
+
+			for (size_t i = 0; i < mr; i++)
+				for (size_t j = 0; j < nr; j++) {
+					T out = accumulate ? C[i * ldc + j] + acc[i][j] : acc[i][j];
+					if (bias) out += bias[j];
+					if (relu) out = out > T(0) ? out : T(0);
+					C[i * ldc + j] = out;
+				}
+		}
+
+		template<typename V>
+		void axpy(size_t n, const typename V::scalar* x, typename V::scalar* y) {
+			constexpr size_t W = V::width;
+			size_t i = 0;
+			for (; i + W <= n; i += W)
+				V::store(y + i, V::add(V::load(y + i), V::load(x + i)));
+			for (; i < n; i++)
+				y[i] += x[i];
+		}
+
+		template<typename V>
+		void relu_mask(size_t n, typename V::scalar* y, const typename V::scalar* mask) {
+			using T = typename V::scalar;
+			constexpr size_t W = V::width;
+			size_t i = 0;
+			for (; i + W <= n; i += W)
+				V::store(y + i, V::relu_mask(V::load(y + i), V::load(mask + i)));
+			for (; i < n; i++)
+				y[i] = mask[i] > T(0) ? y[i] : T(0);
+		}
+
+		// Output columns go NB vectors at a time, kept in registers over all the non-zeros
+		template<typename V>
+		void sparse_row(size_t nnz, const typename V::scalar* values, const uint32_t* index, const typename V::scalar* W, size_t ldw, size_t n, typename V::scalar* y, const typename V::scalar* bias, bool relu) {
+			using T = typename V::scalar;
+			using R = typename V::reg;
+			constexpr size_t Wd = V::width;
+			constexpr size_t NB = 4;
+
+			size_t j = 0;
+			for (; j + NB * Wd <= n; j += NB * Wd) {
+				R c[NB];
+#pragma GCC unroll 4
+				for (size_t v = 0; v < NB; v++)
+					c[v] = bias ? V::load(bias + j + v * Wd) : V::zero();
+				for (size_t p = 0; p < nnz; p++) {
+					const R a = V::broadcast(values + p);
+					const T* W_row = W + index[p] * ldw + j;
+#pragma GCC unroll 4
+					for (size_t v = 0; v < NB; v++)
+						c[v] = V::fmadd(a, V::load(W_row + v * Wd), c[v]);
+				}
+#pragma GCC unroll 4
+				for (size_t v = 0; v < NB; v++)
+					V::store(y + j + v * Wd, relu ? V::relu(c[v]) : c[v]);
+			}
+			for (; j + Wd <= n; j += Wd) {
+				R c = bias ? V::load(bias + j) : V::zero();
+				for (size_t p = 0; p < nnz; p++)
+					c = V::fmadd(V::broadcast(values + p), V::load(W + index[p] * ldw + j), c);
+				V::store(y + j, relu ? V::relu(c) : c);
+			}
+			for (; j < n; j++) {
+				T c = bias ? bias[j] : T(0);
+				for (size_t p = 0; p < nnz; p++)
+					c += values[p] * W[index[p] * ldw + j];
+				y[j] = relu && c < T(0) ? T(0) : c;
+			}
+		}
+
+		// Each non-zero input scales the blocks of its weight row into acc (one L1-resident output row),
+		// then the bias + ReLU epilogue copies acc out
+		template<typename V>
+		void block_sparse_row(size_t k, size_t n, const typename V::scalar* x, const uint32_t* row_start, const uint32_t* block_col, const typename V::scalar* blocks, typename V::scalar* acc, typename V::scalar* y, const typename V::scalar* bias, bool relu) {
+			using T = typename V::scalar;
+			using R = typename V::reg;
+			constexpr size_t Wd = V::width;
+			constexpr size_t NV = sparse_block / Wd;
+			static_assert(sparse_block % Wd == 0, "sparse_block must be a multiple of the vector width");
+
+			const size_t n_padded = (n + sparse_block - 1) / sparse_block * sparse_block;
+			for (size_t j = 0; j < n_padded; j += Wd)
+				V::store(acc + j, V::zero());
+
+			for (size_t p = 0; p < k; p++) {
+				if (x[p] == T(0))
+					continue;
+				const R a = V::broadcast(x + p);
+				for (uint32_t b = row_start[p]; b < row_start[p + 1]; b++) {
+					T* acc_block = acc + block_col[b] * sparse_block;
+					const T* block = blocks + b * sparse_block;
+#pragma GCC unroll 16
+					for (size_t v = 0; v < NV; v++)
+						V::store(acc_block + v * Wd, V::fmadd(a, V::load(block + v * Wd), V::load(acc_block + v * Wd)));
+				}
+			}
+
+			size_t j = 0;
+			for (; j + Wd <= n; j += Wd) {
+				R out = V::load(acc + j);
+				if (bias) out = V::add(out, V::load(bias + j));
+				V::store(y + j, relu ? V::relu(out) : out);
+			}
+			for (; j < n; j++) {
+				T out = bias ? acc[j] + bias[j] : acc[j];
+				y[j] = relu && out < T(0) ? T(0) : out;
+			}
+		}
+
+		// exp(x) within 2 ulp: x = n ln2 + r with |r| <= ln2 / 2, exp(r) from its Taylor series (degree 7 in float,
+		// 13 in double), scaled by 2^n. x is clamped to the range where 2^n stays normal, so underflow ends at ~1e-38 / 1e-308.
+		template<typename V>
+		inline typename V::reg exp_approx(typename V::reg x) {
+			using T = typename V::scalar;
+			using R = typename V::reg;
+			constexpr bool single = sizeof(T) == 4;
+			constexpr int degree = single ? 7 : 13;
+			const T lo = single ? T(-87.3) : T(-708.0);
+			const T hi = single ? T(88.3) : T(709.0);
+			const T log2e = T(1.4426950408889634);
+			// ln2 split so that n * ln2_hi is exact
+			const T minus_ln2_hi = single ? T(-0.693145751953125) : T(-6.93147180369123816490e-01);
+			const T minus_ln2_lo = single ? T(-1.428606820309417232e-06) : T(-1.90821492927058770002e-10);
+
+			x = V::min(V::max(x, V::broadcast(&lo)), V::broadcast(&hi));
+			const R n = V::round(V::mul(x, V::broadcast(&log2e)));
+			R r = V::fmadd(n, V::broadcast(&minus_ln2_hi), x);
+			r = V::fmadd(n, V::broadcast(&minus_ln2_lo), r);
+
+			// Horner on the coefficients 1 / k!
+			T coefficients[degree + 1];
+			coefficients[0] = T(1);
+			for (int k = 1; k <= degree; k++)
+				coefficients[k] = coefficients[k - 1] / T(k);
+			R p = V::broadcast(coefficients + degree);
+			for (int k = degree - 1; k >= 0; k--)
+				p = V::fmadd(p, r, V::broadcast(coefficients + k));
+			return V::mul(p, V::pow2(n));
+		}
+
+		// log(x) for normal x > 0 below the top binade: x = m 2^e with m in [sqrt(1/2), sqrt(2)) (e read off x sqrt(2), m scaled exactly),
+		// then log(m) = 2 atanh(s) = 2 (s + s^3/3 + s^5/5 + ...), s = (m - 1) / (m + 1), |s| <= 0.172
+		template<typename V>
+		inline typename V::reg log_approx(typename V::reg x) {
+			using T = typename V::scalar;
+			using R = typename V::reg;
+			constexpr bool single = sizeof(T) == 4;
+			constexpr int terms = single ? 5 : 11;
+			const T sqrt2 = T(1.4142135623730951);
+			const T one = T(1);
+			const T two = T(2);
+			const T ln2_hi = single ? T(0.693145751953125) : T(6.93147180369123816490e-01);
+			const T ln2_lo = single ? T(1.428606820309417232e-06) : T(1.90821492927058770002e-10);
+
+			const R e = V::exponent(V::mul(x, V::broadcast(&sqrt2)));
+			const R m = V::mul(x, V::pow2(V::sub(V::zero(), e)));
+			const R s = V::div(V::sub(m, V::broadcast(&one)), V::add(m, V::broadcast(&one)));
+			const R s2 = V::mul(s, s);
+
+			const T inv_last = T(1) / T(2 * terms - 1);
+			R p = V::broadcast(&inv_last);
+			for (int k = terms - 2; k >= 0; k--) {
+				const T inv_k = T(1) / T(2 * k + 1);
+				p = V::fmadd(p, s2, V::broadcast(&inv_k));
+			}
+			const R log_m = V::mul(V::mul(V::broadcast(&two), s), p);
+			return V::fmadd(e, V::broadcast(&ln2_hi), V::fmadd(e, V::broadcast(&ln2_lo), log_m));
+		}
+
+		// Max sweep, exp + sum sweep, scale sweep, all over the same L1-resident row.
+		// Tails go through a vector padded in registers so every element uses the same approximation.
+		template<typename V>
+		typename V::scalar softmax_row(size_t n, const typename V::scalar* x, typename V::scalar* y, typename V::scalar* row_max, size_t* argmax) {
+			using T = typename V::scalar;
+			using R = typename V::reg;
+			constexpr size_t Wd = V::width;
+			T lanes[Wd];
+
+			T max = x[0];
+			size_t j = 0;
+			if (n >= Wd) {
+				R m = V::load(x);
+				for (j = Wd; j + Wd <= n; j += Wd)
+					m = V::max(m, V::load(x + j));
+				V::store(lanes, m);
+				for (size_t l = 0; l < Wd; l++)
+					max = lanes[l] > max ? lanes[l] : max;
+			}
+			for (; j < n; j++)
+				max = x[j] > max ? x[j] : max;
+			if (row_max)
+				*row_max = max;
+			// Same rule as the reference argmax (first strict maximum), bounded by n: a NaN max matches no element
+			if (argmax) {
+				size_t best = 0;
+				for (size_t i = 1; i < n; i++)
+					if (x[i] > x[best])
+						best = i;
+				*argmax = best;
+			}
+
+			const R max_v = V::broadcast(&max);
+			R sum_v = V::zero();
+			for (j = 0; j + Wd <= n; j += Wd) {
+				const R e = exp_approx<V>(V::sub(V::load(x + j), max_v));
+				V::store(y + j, e);
+				sum_v = V::add(sum_v, e);
+			}
+			V::store(lanes, sum_v);
+			T sum = T(0);
+			for (size_t l = 0; l < Wd; l++)
+				sum += lanes[l];
+			if (j < n) {
+				for (size_t l = 0; l < Wd; l++)
+					lanes[l] = j + l < n ? x[j + l] : max;
+				V::store(lanes, exp_approx<V>(V::sub(V::load(lanes), max_v)));
+				for (size_t l = 0; j + l < n; l++) {
+					y[j + l] = lanes[l];
+					sum += lanes[l];
+				}
+			}
+
+			const T inv_sum = T(1) / sum;
+			const R inv_sum_v = V::broadcast(&inv_sum);
+			for (j = 0; j + Wd <= n; j += Wd)
+				V::store(y + j, V::mul(V::load(y + j), inv_sum_v));
+			for (; j < n; j++)
+				y[j] *= inv_sum;
+			return sum;
+		}
+
+		template<typename V>
+		void log_row(size_t n, const typename V::scalar* x, typename V::scalar* y) {
+			using T = typename V::scalar;
+			constexpr size_t Wd = V::width;
+			size_t j = 0;
+			for (; j + Wd <= n; j += Wd)
+				V::store(y + j, log_approx<V>(V::load(x + j)));
+			if (j < n) {
+				T lanes[Wd];
+				for (size_t l = 0; l < Wd; l++)
+					lanes[l] = j + l < n ? x[j + l] : T(1);
+				V::store(lanes, log_approx<V>(V::load(lanes)));
+				for (size_t l = 0; j + l < n; l++)
+					y[j + l] = lanes[l];
+			}
+		}
+
+		// Extra register tile for make_table: MR x NR, k loop unrolled U times
+		template<size_t MR, size_t NR, size_t U = 1>
+		struct TileShape {};
+
+		template<typename V, size_t MR, size_t NR, size_t U>
+		void add_tile(Table<typename V::scalar>& table, TileShape<MR, NR, U>) {
+			static_assert(NR % V::width == 0, "NR must be a multiple of the vector width");
+			if (table.n_tiles < Table<typename V::scalar>::max_tiles)
+				table.tiles[table.n_tiles++] = { MR, NR, U, microkernel<V, MR, NR, U> };
+		}
+
+		// MR x NR is the default tile. The autotuner also tries it with the k loop unrolled 4 times, and every Extra shape.
+		template<typename V, size_t MR, size_t NR, typename... Extra>
+		Table<typename V::scalar> make_table(ISA isa, const char* name) {
+			Table<typename V::scalar> table{ isa, name, MR, NR, microkernel<V, MR, NR, 1>, axpy<V>, relu_mask<V>, sparse_row<V>, block_sparse_row<V>, softmax_row<V>, log_row<V>, {}, 0 };
+			add_tile<V>(table, TileShape<MR, NR, 1>());
+			add_tile<V>(table, TileShape<MR, NR, 4>());
+			(add_tile<V>(table, Extra()), ...);
+			return table;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,69 @@
+#include "Kernels.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+
+#pragma GCC target("sse4.2")
+#include "Kernels_impl.hpp"
+
+
+namespace KERNELS {
+
+	// ======== SSE4.2 VECTORS ======== //
+	struct SSE_float {
+		using scalar = float;
+		using reg = __m128;
+		static constexpr size_t width = 4;
+
+		static inline reg zero() { return _mm_setzero_ps(); }
+		static inline reg load(const float* p) { return _mm_loadu_ps(p); }
+		static inline void store(float* p, reg v) { _mm_storeu_ps(p, v); }
+		static inline reg broadcast(const float* p) { return _mm_set1_ps(*p); }
+		static inline reg fmadd(reg a, reg b, reg c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+		static inline reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+		static inline reg relu(reg v) { return _mm_max_ps(v, _mm_setzero_ps()); }
+		static inline reg relu_mask(reg y, reg mask) { return _mm_and_ps(y, _mm_cmpgt_ps(mask, _mm_setzero_ps())); }
+		static inline reg sub(reg a, reg b) { return _mm_sub_ps(a, b); }
+		static inline reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+		static inline reg div(reg a, reg b) { return _mm_div_ps(a, b); }
+		static inline reg min(reg a, reg b) { return _mm_min_ps(a, b); }
+		static inline reg max(reg a, reg b) { return _mm_max_ps(a, b); }
+		static inline reg round(reg v) { return _mm_round_ps(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		// 2^n for integral n in the normal range, built in the exponent field
+		static inline reg pow2(reg n) { return _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(n), _mm_set1_epi32(127)), 23)); }
+		// floor(log2(v)) for normal v > 0, read off the exponent field
+		static inline reg exponent(reg v) { return _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(_mm_castps_si128(v), 23), _mm_set1_epi32(127))); }
+	};
+
+	struct SSE_double {
+		using scalar = double;
+		using reg = __m128d;
+		static constexpr size_t width = 2;
+
+		static inline reg zero() { return _mm_setzero_pd(); }
+		static inline reg load(const double* p) { return _mm_loadu_pd(p); }
+		static inline void store(double* p, reg v) { _mm_storeu_pd(p, v); }
+		static inline reg broadcast(const double* p) { return _mm_set1_pd(*p); }
+		static inline reg fmadd(reg a, reg b, reg c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+		static inline reg add(reg a, reg b) { return _mm_add_pd(a, b); }
+		static inline reg relu(reg v) { return _mm_max_pd(v, _mm_setzero_pd()); }
+		static inline reg relu_mask(reg y, reg mask) { return _mm_and_pd(y, _mm_cmpgt_pd(mask, _mm_setzero_pd())); }
+		static inline reg sub(reg a, reg b) { return _mm_sub_pd(a, b); }
+		static inline reg mul(reg a, reg b) { return _mm_mul_pd(a, b); }
+		static inline reg div(reg a, reg b) { return _mm_div_pd(a, b); }
+		static inline reg min(reg a, reg b) { return _mm_min_pd(a, b); }
+		static inline reg max(reg a, reg b) { return _mm_max_pd(a, b); }
+		static inline reg round(reg v) { return _mm_round_pd(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		static inline reg pow2(reg n) { return _mm_castsi128_pd(_mm_slli_epi64(_mm_add_epi64(_mm_cvtepi32_epi64(_mm_cvtpd_epi32(n)), _mm_set1_epi64x(1023)), 52)); }
+		// No int64 -> double conversion before AVX-512: the biased exponent is placed in the mantissa of 2^52, then 2^52 + 1023 is subtracted
+		static inline reg exponent(reg v) {
+			const __m128i biased = _mm_srli_epi64(_mm_castpd_si128(v), 52);
+			return _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(biased, _mm_castpd_si128(_mm_set1_pd(4503599627370496.0)))), _mm_set1_pd(4503599627370496.0 + 1023.0));
+		}
+	};
+
+	Table<float> sse42_table_float() { return make_table<SSE_float, 4, 8, TileShape<6, 8>, TileShape<4, 12>>(ISA::SSE42, "sse4.2"); }
+	Table<double> sse42_table_double() { return make_table<SSE_double, 4, 4, TileShape<6, 4>, TileShape<4, 6>>(ISA::SSE42, "sse4.2"); }
+}
+
+#endif
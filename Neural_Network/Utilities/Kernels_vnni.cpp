@@ -0,0 +1,50 @@
+#include "Kernels.hpp"
+
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+
+#pragma GCC target("avx512f,avx512bw,avx512vnni")
+
+
+namespace KERNELS {
+
+	// ======== INT8 : AVX-512 VNNI, 8 x 16 ======== //
+	// vpdpbusd: a broadcast u8 quadruple of X times 16 s8 quadruples of W, accumulated straight into s32 lanes
+	static void vnni_gemm_u8s8(size_t m, size_t n, size_t k, const uint8_t* X, const int8_t* W, int32_t* C) {
+		constexpr size_t MR = 8;
+
+		for (size_t i0 = 0; i0 < m; i0 += MR) {
+			const size_t mr = m - i0 < MR ? m - i0 : MR;
+			const uint8_t* x_row[MR];
+			for (size_t r = 0; r < MR; r++)
+				x_row[r] = X + (i0 + (r < mr ? r : mr - 1)) * k;
+
+			for (size_t j0 = 0; j0 < n; j0 += 16) {
+				__m512i c[MR];
+#pragma GCC unroll 8
+				for (size_t r = 0; r < MR; r++)
+					c[r] = _mm512_setzero_si512();
+
+				const int8_t* W_panel = W + j0 * 4;
+				for (size_t p = 0; p < k; p += 4) {
+					const __m512i w = _mm512_loadu_si512(W_panel + p * n);
+#pragma GCC unroll 8
+					for (size_t r = 0; r < MR; r++) {
+						int32_t quad;
+						std::memcpy(&quad, x_row[r] + p, sizeof(quad));
+						c[r] = _mm512_dpbusd_epi32(c[r], _mm512_set1_epi32(quad), w);
+					}
+				}
+
+				for (size_t r = 0; r < mr; r++)
+					_mm512_storeu_si512(C + (i0 + r) * n + j0, c[r]);
+			}
+		}
+	}
+
+	QuantTable vnni_quant_table() { return QuantTable{ "avx512-vnni", vnni_gemm_u8s8 }; }
+}
+
+#endif
@@ -1,6 +1,7 @@
 #include "Matrix.hpp"
 
-Matrix::Matrix(std::initializer_list<std::initializer_list<double>> init) {
+template<typename Scalar>
+BasicMatrix<Scalar>::BasicMatrix(std::initializer_list<std::initializer_list<Scalar>> init) {
 	_rows = init.size();
 	_cols = init.begin()->size();
 
@@ -10,7 +11,8 @@ Matrix::Matrix(std::initializer_list<std::initializer_list<double>> init) {
 	for (const auto& row : init)
 		_matrix.insert(_matrix.end(), row.begin(), row.end());
 }
-Matrix::Matrix(std::vector<std::vector<double>> init) {
+template<typename Scalar>
+BasicMatrix<Scalar>::BasicMatrix(std::vector<std::vector<double>> init) {
 	_rows = init.size();
 	_cols = init.begin()->size();
 
@@ -20,7 +22,8 @@ Matrix::Matrix(std::vector<std::vector<double>> init) {
 	for (const auto& row : init)
 		_matrix.insert(_matrix.end(), row.begin(), row.end());
 }
-Matrix& Matrix::operator=(std::initializer_list<std::initializer_list<double>> init) {
+template<typename Scalar>
+BasicMatrix<Scalar>& BasicMatrix<Scalar>::operator=(std::initializer_list<std::initializer_list<Scalar>> init) {
 	_rows = init.size();
 	_cols = init.begin()->size();
 
@@ -33,38 +36,26 @@ Matrix& Matrix::operator=(std::initializer_list<std::initializer_list<double>> i
 	return *this;
 }
 
-Matrix Matrix::operator*(const Matrix& B) const {
+template<typename Scalar>
+BasicMatrix<Scalar> BasicMatrix<Scalar>::operator*(const BasicMatrix& B) const {
+	BasicMatrix C;
+	multiply_into(C, B);
+	return C;
+}
+template<typename Scalar>
+void BasicMatrix<Scalar>::multiply_into(BasicMatrix& dst, const BasicMatrix& B) const {
 	assert(_cols == B.rows());
+	assert(&dst != this && &dst != &B);
 
 	size_t new_cols = B.cols();
-	Matrix C(_rows, new_cols);
+	dst.resize(_rows, new_cols);
 
-	for (size_t i = 0; i < _rows; i++) {
-		size_t row_offset = i * _cols;
-		for (size_t k = 0; k < _cols; k++) {
-			double Aik = _matrix[row_offset + k];
-			for (size_t j = 0; j < new_cols; j++)
-				C(i, j) += Aik * B(k, j);
-		}
-	}
-
-	return C;
+	GEMM::gemm<Scalar>(_rows, new_cols, _cols, data(), _cols, B.data(), new_cols, dst.data(), new_cols);
 }
 
 
-Matrix Matrix::operator*(const double b) const {
-
-	Matrix C(_rows, _cols);
-
-	for (size_t i = 0; i < _rows; i++) {
-		size_t row_offset = i * _cols;
-		for (size_t j = 0; j < _cols; j++)
-			C(i, j) = _matrix[row_offset + j] * b;
-	}
-
-	return C;
-}
-Matrix& Matrix::operator*=(const double b) {
+template<typename Scalar>
+BasicMatrix<Scalar>& BasicMatrix<Scalar>::operator*=(const Scalar b) {
 
 	for (size_t idx = 0; idx < _rows * _cols; idx++)
 		_matrix[idx] *= b;
@@ -72,20 +63,8 @@ Matrix& Matrix::operator*=(const double b) {
 	return *this;
 }
 
-Matrix Matrix::hadamard(const Matrix& B) const {
-	assert(_rows == B.rows());
-	assert(_cols == B.cols());
-
-	Matrix C(_rows, _cols);
-	for (size_t i = 0; i < _rows; i++) {
-		size_t row_offset = i * _cols;
-		for (size_t j = 0; j < _cols; j++)
-			C(i, j) = _matrix[row_offset + j] * B(i, j);
-	}
-
-	return C;
-}
-const bool Matrix::operator==(const Matrix& B) const {
+template<typename Scalar>
+const bool BasicMatrix<Scalar>::operator==(const BasicMatrix& B) const {
 	if (_rows == B.rows()) {
 		if (_cols == B.cols()) {
 			for (size_t idx = 0; idx < _rows * _cols; idx++)
@@ -99,21 +78,8 @@ const bool Matrix::operator==(const Matrix& B) const {
 }
 
 
-Matrix Matrix::operator+(const Matrix& B) const {
-	assert(_rows == B.rows());
-	assert(_cols == B.cols());
-
-	Matrix C(_rows, _cols);
-	for (size_t i = 0; i < _rows; i++) {
-		size_t row_offset = i * _cols;
-		for (size_t j = 0; j < _cols; j++)
-			C(i, j) = _matrix[row_offset + j] + B(i, j);
-	}
-
-	return C;
-}
-
-Matrix& Matrix::operator+=(const Matrix& B) {
+template<typename Scalar>
+BasicMatrix<Scalar>& BasicMatrix<Scalar>::operator+=(const BasicMatrix& B) {
 	assert(_rows == B.rows());
 	assert(_cols == B.cols());
 
@@ -126,21 +92,8 @@ Matrix& Matrix::operator+=(const Matrix& B) {
 	return *this;
 }
 
-Matrix Matrix::operator-(const Matrix& B) const {
-	assert(_rows == B.rows());
-	assert(_cols == B.cols());
-
-	Matrix C(_rows, _cols);
-	for (size_t i = 0; i < _rows; i++) {
-		size_t row_offset = i * _cols;
-		for (size_t j = 0; j < _cols; j++)
-			C(i, j) = _matrix[row_offset + j] - B(i, j);
-	}
-
-	return C;
-}
-
-Matrix& Matrix::operator-=(const Matrix& B) {
+template<typename Scalar>
+BasicMatrix<Scalar>& BasicMatrix<Scalar>::operator-=(const BasicMatrix& B) {
 	assert(_rows == B.rows());
 	assert(_cols == B.cols());
 
@@ -155,86 +108,108 @@ Matrix& Matrix::operator-=(const Matrix& B) {
 
 
 
-Matrix Matrix::T() const {
+template<typename Scalar>
+BasicMatrix<Scalar> BasicMatrix<Scalar>::T() const { BasicMatrix C; T_into(C); return C; }
+template<typename Scalar>
+BasicMatrix<Scalar> BasicMatrix<Scalar>::addBias() const { BasicMatrix C; addBias_into(C); return C; }
+template<typename Scalar>
+BasicMatrix<Scalar> BasicMatrix<Scalar>::addBias_then_T() const { BasicMatrix C; addBias_then_T_into(C); return C; }
+template<typename Scalar>
+BasicMatrix<Scalar> BasicMatrix<Scalar>::removeBias() const { BasicMatrix C; removeBias_into(C); return C; }
+template<typename Scalar>
+BasicMatrix<Scalar> BasicMatrix<Scalar>::T_then_removeBias() const { BasicMatrix C; T_then_removeBias_into(C); return C; }
+template<typename Scalar>
+BasicMatrix<Scalar> BasicMatrix<Scalar>::dropoutMask(Scalar dropout) const { BasicMatrix C; dropoutMask_into(C, dropout); return C; }
+template<typename Scalar>
+BasicMatrix<Scalar> BasicMatrix<Scalar>::setMaxToOne() const { BasicMatrix C; setMaxToOne_into(C); return C; }
+
 
-	Matrix C(_cols, _rows);
+template<typename Scalar>
+void BasicMatrix<Scalar>::T_into(BasicMatrix& C) const {
+	assert(&C != this);
+
+	C.resize(_cols, _rows);
 	for (size_t j = 0; j < _rows; j++) {
 		size_t row_offset = j * _cols;
 		for (size_t i = 0; i < _cols; i++)
 			C(i, j) = _matrix[row_offset + i];
 	}
-
-	return C;
 }
-Matrix Matrix::addBias() const {
+template<typename Scalar>
+void BasicMatrix<Scalar>::addBias_into(BasicMatrix& C) const {
+	assert(&C != this);
 
-	Matrix C(_rows, _cols + 1);
+	C.resize(_rows, _cols + 1);
 	for (size_t i = 0; i < _rows; i++) {
 		size_t row_offset = i * _cols;
 		for (size_t j = 0; j < _cols; j++)
 			C(i, j) = _matrix[row_offset + j];
 		C(i, _cols) = 1;
 	}
-
-	return C;
 }
-Matrix Matrix::addBias_then_T() const {
+template<typename Scalar>
+void BasicMatrix<Scalar>::addBias_then_T_into(BasicMatrix& C) const {
+	assert(&C != this);
 
-	Matrix C(_cols + 1, _rows);
+	C.resize(_cols + 1, _rows);
 	for (size_t j = 0; j < _rows; j++) {
 		size_t row_offset = j * _cols;
 		for (size_t i = 0; i < _cols; i++)
 			C(i, j) = _matrix[row_offset + i];
 		C(_cols, j) = 1;
 	}
-
-	return C;
 }
-Matrix Matrix::removeBias() const {
+template<typename Scalar>
+void BasicMatrix<Scalar>::removeBias_into(BasicMatrix& C) const {
+	assert(&C != this);
 
-	Matrix C(_rows - 1, _cols);
+	C.resize(_rows - 1, _cols);
 	for (size_t i = 0; i < _rows - 1; i++) {
 		size_t row_offset = i * _cols;
 		for (size_t j = 0; j < _cols; j++)
 			C(i, j) = _matrix[row_offset + j];
 	}
-
-	return C;
 }
-Matrix Matrix::T_then_removeBias() const {
+template<typename Scalar>
+void BasicMatrix<Scalar>::T_then_removeBias_into(BasicMatrix& C) const {
+	assert(&C != this);
 
-	Matrix C(_cols, _rows - 1);
+	C.resize(_cols, _rows - 1);
 	for (size_t i = 0; i < _cols; i++)
 		for (size_t j = 0; j < _rows - 1; j++)
 			C(i, j) = (*this)(j, i);
-
-	return C;
 }
 
-Matrix Matrix::dropoutMask(double dropout) const {
-	double keep_prob = 1.0 - dropout;
+// Element-wise, so dst may be *this
+template<typename Scalar>
+void BasicMatrix<Scalar>::dropoutMask_into(BasicMatrix& C, Scalar dropout) const {
+	Scalar keep_prob = Scalar(1) - dropout;
 
-	Matrix C(_rows, _cols);
+	// One generator per thread: data-parallel replicas draw their masks concurrently
+	thread_local std::minstd_rand rng{ std::random_device{}() };
+	std::uniform_real_distribution<Scalar> uniform(Scalar(0), Scalar(1));
+
+	C.resize(_rows, _cols);
 	for (size_t i = 0; i < _rows; ++i) {
 		size_t row_offset = i * _cols;
 		for (size_t j = 0; j < _cols; ++j)
-			C(i, j) = ((double)rand() / RAND_MAX > keep_prob) ? 0.0 : (_matrix[row_offset + j] / keep_prob);
+			C(i, j) = (uniform(rng) > keep_prob) ? Scalar(0) : (_matrix[row_offset + j] / keep_prob);
 	}
-
-	return C;
 }
 
-Matrix Matrix::setMaxToOne() const {
-
+template<typename Scalar>
+void BasicMatrix<Scalar>::setMaxToOne_into(BasicMatrix& C) const {
+	assert(&C != this);
 
-	Matrix C(_rows, _cols);
+	C.resize(_rows, _cols);
+	C.fill(0);
 	for (size_t i = 0; i < _rows; i++) {
 		size_t row_offset = i * _cols;
 
-		double max_value = _matrix[row_offset];
+		Scalar max_value = _matrix[row_offset];
 		size_t max_index = 0;
 		for (size_t j = 0; j < _cols; j++) {
-			double element = _matrix[row_offset + j];
+			Scalar element = _matrix[row_offset + j];
 			if (element > max_value) {
 				max_value = element;
 				max_index = j;
@@ -242,18 +217,17 @@ Matrix Matrix::setMaxToOne() const {
 		}
 		C(i, max_index) = 1;
 	}
-
-	return C;
 }
 
-int Matrix::getMaxIndex() const {
+template<typename Scalar>
+int BasicMatrix<Scalar>::getMaxIndex() const {
 
 	assert(_rows == 1);
 
-	double max = _matrix[0];
+	Scalar max = _matrix[0];
 	int index = 0;
 	for (size_t j = 1; j < _cols; j++) {
-		double val = _matrix[j];
+		Scalar val = _matrix[j];
 		if (val > max) {
 			max = val;
 			index = j;
@@ -262,8 +236,12 @@ int Matrix::getMaxIndex() const {
 	return index;
 }
 
-void Matrix::fill(const double b) {
+template<typename Scalar>
+void BasicMatrix<Scalar>::fill(const Scalar b) {
 
 	for (size_t idx = 0; idx < _rows * _cols; idx++)
 		_matrix[idx] = b;
-}
\ No newline at end of file
+}
+
+template class BasicMatrix<float>;
+template class BasicMatrix<double>;
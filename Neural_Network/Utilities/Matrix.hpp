@@ -10,64 +10,140 @@
 #include <vector>
 #include <cmath>
 
+#include "AlignedAllocator.hpp"
+#include "Gemm.hpp"
+#include "MatrixExpr.hpp"
+#include "MatrixView.hpp"
+
 
 #ifndef MATRIX_H
 #define MATRIX_H
 
 using d_vector = std::vector<double>;
 using d_matrix = std::vector<std::vector<double>>;
+using i_vector = std::vector<int>;
 #pragma GCC diagnostic ignored "-Wnarrowing"
 
-class Matrix {
+template<typename Scalar>
+class BasicMatrix {
 private:
 	size_t _rows;
 	size_t _cols;
 
-	d_vector _matrix;
+	MEMORY::aligned_vector<Scalar> _matrix; // 64-byte aligned, see AlignedAllocator.hpp
 
 public:
+	using value_type = Scalar;
+
 	size_t rows() const { return _rows; };
 	size_t cols() const { return _cols; };
 
 	// Constructors
-	inline Matrix() {};
-	Matrix(std::vector<std::vector<double>>);
-	Matrix(std::initializer_list<std::initializer_list<double>>);
-	inline Matrix(const double a) : _rows(1), _cols(1), _matrix(d_vector(1, a)) {};
-	inline Matrix(size_t row, size_t columns) : _rows(row), _cols(columns), _matrix(d_vector(_rows * _cols, 0.0)) {};
+	inline BasicMatrix() : _rows(0), _cols(0) {};
+	BasicMatrix(std::vector<std::vector<double>>);
+	BasicMatrix(std::initializer_list<std::initializer_list<Scalar>>);
+	inline BasicMatrix(const Scalar a) : _rows(1), _cols(1), _matrix(1, a) {};
+	inline BasicMatrix(size_t row, size_t columns) : _rows(row), _cols(columns), _matrix(_rows * _cols, Scalar(0)) {};
+	template<typename E> inline BasicMatrix(const EXPR::Expr<E, Scalar>& expr) : _rows(0), _cols(0) { *this = expr; };
 
 	// Operators
-	Matrix& operator=(std::initializer_list<std::initializer_list<double>>);
-	Matrix operator*(const Matrix& B) const;
-	Matrix operator*(const double b) const;
-	Matrix& operator*=(const double b);
-	Matrix hadamard(const Matrix& B) const;
-	const bool operator==(const Matrix& B) const;
-
-	Matrix operator+(const Matrix& B) const;
-	Matrix& operator+=(const Matrix& B);
-	Matrix operator-(const Matrix& B) const;
-	Matrix& operator-=(const Matrix& B);
+	BasicMatrix& operator=(std::initializer_list<std::initializer_list<Scalar>>);
+	BasicMatrix operator*(const BasicMatrix& B) const;
+	BasicMatrix& operator*=(const Scalar b);
+	const bool operator==(const BasicMatrix& B) const;
+
+	BasicMatrix& operator+=(const BasicMatrix& B);
+	BasicMatrix& operator-=(const BasicMatrix& B);
+
+	// Element-wise operators are lazy (see MatrixExpr.hpp), evaluated into the destination on assignment
+	inline auto operator+(const BasicMatrix& B) const { return EXPR::make_binary<EXPR::Add>(*this, B); };
+	inline auto operator-(const BasicMatrix& B) const { return EXPR::make_binary<EXPR::Sub>(*this, B); };
+	inline auto hadamard(const BasicMatrix& B) const { return EXPR::make_binary<EXPR::Mul>(*this, B); };
+	template<typename E> inline auto operator+(const EXPR::Expr<E, Scalar>& B) const { return EXPR::make_binary<EXPR::Add>(*this, B.self()); };
+	template<typename E> inline auto operator-(const EXPR::Expr<E, Scalar>& B) const { return EXPR::make_binary<EXPR::Sub>(*this, B.self()); };
+	template<typename E> inline auto hadamard(const EXPR::Expr<E, Scalar>& B) const { return EXPR::make_binary<EXPR::Mul>(*this, B.self()); };
+	inline EXPR::Scaled<EXPR::Leaf<Scalar>> operator*(const Scalar b) const { return EXPR::Scaled<EXPR::Leaf<Scalar>>(EXPR::node<BasicMatrix>::get(*this), b); };
+
+	template<typename E> BasicMatrix& operator=(const EXPR::Expr<E, Scalar>& expr);
+	template<typename E> BasicMatrix& operator+=(const EXPR::Expr<E, Scalar>& expr);
+	template<typename E> BasicMatrix& operator-=(const EXPR::Expr<E, Scalar>& expr);
 
 	// Modification
-	Matrix T() const;
-	Matrix addBias() const;
-	Matrix addBias_then_T() const;
-	Matrix removeBias() const;
-	Matrix T_then_removeBias() const;
-	Matrix dropoutMask(double dropout) const;
-	Matrix setMaxToOne() const;
-
-	void fill(const double b);
+	BasicMatrix T() const;
+	BasicMatrix addBias() const;
+	BasicMatrix addBias_then_T() const;
+	BasicMatrix removeBias() const;
+	BasicMatrix T_then_removeBias() const;
+	BasicMatrix dropoutMask(Scalar dropout) const;
+	BasicMatrix setMaxToOne() const;
+
+	// Same, written into dst: its storage is reused when the shape matches, so steady-state calls don't allocate
+	void multiply_into(BasicMatrix& dst, const BasicMatrix& B) const;
+	void T_into(BasicMatrix& dst) const;
+	void addBias_into(BasicMatrix& dst) const;
+	void addBias_then_T_into(BasicMatrix& dst) const;
+	void removeBias_into(BasicMatrix& dst) const;
+	void T_then_removeBias_into(BasicMatrix& dst) const;
+	void dropoutMask_into(BasicMatrix& dst, Scalar dropout) const;
+	void setMaxToOne_into(BasicMatrix& dst) const;
+
+	// Reshape without shrinking the capacity. Contents are unspecified afterwards.
+	inline void resize(size_t rows, size_t cols) { _rows = rows; _cols = cols; _matrix.resize(rows * cols); };
+	void fill(const Scalar b);
 	int getMaxIndex() const;
 
 	// Getting data
-	inline double& operator()(size_t idx) { return _matrix[idx]; };
-	inline const double& operator()(size_t idx) const { return _matrix[idx]; };
-	inline double& operator()(size_t i, size_t j) { return _matrix[i * _cols + j]; };
-	inline const double& operator()(size_t i, size_t j) const { return _matrix[i * _cols + j]; };
-	inline Matrix getParams() const { return Matrix{ {static_cast<double>(_rows), static_cast<double>(_cols)} }; };
-	inline std::vector<double> row(int i) { return std::vector<double>(_matrix.begin() + i * _cols, _matrix.begin() + (i + 1) * _cols); };
+	inline Scalar& operator()(size_t idx) { return _matrix[idx]; };
+	inline const Scalar& operator()(size_t idx) const { return _matrix[idx]; };
+	inline Scalar& operator()(size_t i, size_t j) { return _matrix[i * _cols + j]; };
+	inline const Scalar& operator()(size_t i, size_t j) const { return _matrix[i * _cols + j]; };
+	inline Scalar* data() { return _matrix.data(); };
+	inline const Scalar* data() const { return _matrix.data(); };
+	inline BasicMatrix getParams() const { return BasicMatrix{ {static_cast<Scalar>(_rows), static_cast<Scalar>(_cols)} }; };
+	inline BasicMatrixView<Scalar> row(size_t i) { return view().row(i); };
+	inline BasicMatrixView<const Scalar> row(size_t i) const { return view().row(i); };
+
+	// Non-owning views, see MatrixView.hpp
+	inline BasicMatrixView<Scalar> view() { return BasicMatrixView<Scalar>(data(), _rows, _cols); };
+	inline BasicMatrixView<const Scalar> view() const { return BasicMatrixView<const Scalar>(data(), _rows, _cols); };
 };
 
+// Storage is reused when the shape already matches, so M = M * b + dW * c allocates nothing
+template<typename Scalar>
+template<typename E>
+inline BasicMatrix<Scalar>& BasicMatrix<Scalar>::operator=(const EXPR::Expr<E, Scalar>& expr) {
+	const E& e = expr.self();
+	if (_rows != e.rows() || _cols != e.cols()) {
+		resize(e.rows(), e.cols());
+	}
+	EXPR::evaluate<EXPR::Assign>(_matrix.data(), e, _rows * _cols);
+	return *this;
+}
+template<typename Scalar>
+template<typename E>
+inline BasicMatrix<Scalar>& BasicMatrix<Scalar>::operator+=(const EXPR::Expr<E, Scalar>& expr) {
+	assert(_rows == expr.self().rows());
+	assert(_cols == expr.self().cols());
+	EXPR::evaluate<EXPR::Add>(_matrix.data(), expr.self(), _rows * _cols);
+	return *this;
+}
+template<typename Scalar>
+template<typename E>
+inline BasicMatrix<Scalar>& BasicMatrix<Scalar>::operator-=(const EXPR::Expr<E, Scalar>& expr) {
+	assert(_rows == expr.self().rows());
+	assert(_cols == expr.self().cols());
+	EXPR::evaluate<EXPR::Sub>(_matrix.data(), expr.self(), _rows * _cols);
+	return *this;
+}
+
+// Element type of the network, chosen per build: float32 by default, -DFFNN_DOUBLE for float64.
+#ifdef FFNN_DOUBLE
+using real = double;
+#else
+using real = float;
+#endif
+using Matrix = BasicMatrix<real>;
+using MatrixView = BasicMatrixView<real>;
+using ConstMatrixView = BasicMatrixView<const real>;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include <cassert>
+#include <cstddef>
+
+
+#ifndef MATRIX_EXPR_HPP
+#define MATRIX_EXPR_HPP
+
+template<typename Scalar> class BasicMatrix;
+
+
+// ======== EXPRESSION TEMPLATES ======== //
+// Element-wise +, -, scalar * and hadamard build lazy nodes instead of temporaries.
+// Nothing is computed until the expression is assigned to a matrix, then in a single loop.
+// Leaves only point at their matrices: keep expressions inside one statement (no auto).
+namespace EXPR {
+
+	template<typename E, typename Scalar> struct Expr;
+	template<typename Scalar> struct Leaf;
+	template<typename L, typename R, typename Op> struct Binary;
+	template<typename E> struct Scaled;
+
+	struct Add { template<typename T> static inline T apply(T a, T b) { return a + b; }; };
+	struct Sub { template<typename T> static inline T apply(T a, T b) { return a - b; }; };
+	struct Mul { template<typename T> static inline T apply(T a, T b) { return a * b; }; };
+
+	// Operand storage: matrices are held as leaves, nodes by value
+	template<typename X> struct node {
+		using type = X;
+		static inline const X& get(const X& x) { return x; };
+	};
+	template<typename Scalar> struct node<BasicMatrix<Scalar>> {
+		using type = Leaf<Scalar>;
+		static inline Leaf<Scalar> get(const BasicMatrix<Scalar>& m) { return Leaf<Scalar>(m.data(), m.rows(), m.cols()); };
+	};
+	template<typename X> using node_t = typename node<X>::type;
+
+	template<typename Op, typename L, typename R>
+	inline Binary<node_t<L>, node_t<R>, Op> make_binary(const L& l, const R& r) {
+		return Binary<node_t<L>, node_t<R>, Op>(node<L>::get(l), node<R>::get(r));
+	};
+
+	// CRTP base: every node has rows(), cols() and a flat operator[](idx)
+	template<typename E, typename Scalar>
+	struct Expr {
+		using value_type = Scalar;
+		inline const E& self() const { return static_cast<const E&>(*this); };
+
+		template<typename R> inline auto operator+(const Expr<R, Scalar>& r) const { return make_binary<Add>(self(), r.self()); };
+		template<typename R> inline auto operator-(const Expr<R, Scalar>& r) const { return make_binary<Sub>(self(), r.self()); };
+		template<typename R> inline auto hadamard(const Expr<R, Scalar>& r) const { return make_binary<Mul>(self(), r.self()); };
+		inline auto operator+(const BasicMatrix<Scalar>& r) const { return make_binary<Add>(self(), r); };
+		inline auto operator-(const BasicMatrix<Scalar>& r) const { return make_binary<Sub>(self(), r); };
+		inline auto hadamard(const BasicMatrix<Scalar>& r) const { return make_binary<Mul>(self(), r); };
+		inline Scaled<E> operator*(const Scalar b) const { return Scaled<E>(self(), b); };
+	};
+
+	template<typename Scalar>
+	struct Leaf : Expr<Leaf<Scalar>, Scalar> {
+		const Scalar* _data;
+		size_t _rows, _cols;
+
+		inline Leaf(const Scalar* data, size_t rows, size_t cols) : _data(data), _rows(rows), _cols(cols) {};
+		inline size_t rows() const { return _rows; };
+		inline size_t cols() const { return _cols; };
+		inline Scalar operator[](size_t idx) const { return _data[idx]; };
+	};
+
+	template<typename L, typename R, typename Op>
+	struct Binary : Expr<Binary<L, R, Op>, typename L::value_type> {
+		L _l;
+		R _r;
+
+		inline Binary(const L& l, const R& r) : _l(l), _r(r) {
+			assert(l.rows() == r.rows());
+			assert(l.cols() == r.cols());
+		};
+		inline size_t rows() const { return _l.rows(); };
+		inline size_t cols() const { return _l.cols(); };
+		inline typename L::value_type operator[](size_t idx) const { return Op::apply(_l[idx], _r[idx]); };
+	};
+
+	template<typename E>
+	struct Scaled : Expr<Scaled<E>, typename E::value_type> {
+		using Scalar = typename E::value_type;
+		E _e;
+		Scalar _b;
+
+		inline Scaled(const E& e, Scalar b) : _e(e), _b(b) {};
+		inline size_t rows() const { return _e.rows(); };
+		inline size_t cols() const { return _e.cols(); };
+		inline Scalar operator[](size_t idx) const { return _e[idx] * _b; };
+	};
+
+	// dst[idx] = Op(dst[idx], e[idx]) in one pass. Blocks of 8 with a fixed trip count so -O2 vectorizes them;
+	// dst may alias the leaves since every element is read before it is written at the same index.
+	template<typename Op, typename Scalar, typename E>
+	inline void evaluate(Scalar* dst, const E& e, size_t n) {
+		constexpr size_t block = 8;
+		size_t idx = 0;
+		for (; idx + block <= n; idx += block) {
+			Scalar tmp[block];
+			for (size_t b = 0; b < block; b++)
+				tmp[b] = e[idx + b];
+			for (size_t b = 0; b < block; b++)
+				dst[idx + b] = Op::apply(dst[idx + b], tmp[b]);
+		}
+		for (; idx < n; idx++)
+			dst[idx] = Op::apply(dst[idx], e[idx]);
+	};
+
+	struct Assign { template<typename T> static inline T apply(T, T b) { return b; }; };
+}
+
+#endif
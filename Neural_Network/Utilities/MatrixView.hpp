@@ -0,0 +1,62 @@
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+
+
+#ifndef MATRIX_VIEW_HPP
+#define MATRIX_VIEW_HPP
+
+template<typename Scalar> class BasicMatrix;
+
+
+// ======== MATRIX VIEW ======== //
+// Non-owning rows x cols window over row-major memory, with a row stride (in elements).
+// Scalar is const for read-only views. Batches, rows and column blocks are sliced without copies;
+// the viewed matrix must outlive the view and must not be resized meanwhile.
+template<typename Scalar>
+class BasicMatrixView {
+private:
+	Scalar* _data = nullptr;
+	size_t _rows = 0;
+	size_t _cols = 0;
+	size_t _stride = 0;
+
+public:
+	using value_type = std::remove_const_t<Scalar>;
+
+	inline BasicMatrixView() {};
+	inline BasicMatrixView(Scalar* data, size_t rows, size_t cols, size_t stride) : _data(data), _rows(rows), _cols(cols), _stride(stride) { assert(stride >= cols || rows <= 1); };
+	inline BasicMatrixView(Scalar* data, size_t rows, size_t cols) : BasicMatrixView(data, rows, cols, cols) {};
+
+	// Whole matrices, and mutable views, convert implicitly to (read-only) views
+	inline BasicMatrixView(BasicMatrix<value_type>& matrix) : BasicMatrixView(matrix.data(), matrix.rows(), matrix.cols()) {};
+	template<typename S = Scalar, typename = std::enable_if_t<std::is_const_v<S>>>
+	inline BasicMatrixView(const BasicMatrix<value_type>& matrix) : BasicMatrixView(matrix.data(), matrix.rows(), matrix.cols()) {};
+	template<typename S, typename = std::enable_if_t<std::is_same_v<const S, Scalar> && !std::is_same_v<S, Scalar>>>
+	inline BasicMatrixView(const BasicMatrixView<S>& view) : BasicMatrixView(view.data(), view.rows(), view.cols(), view.stride()) {};
+
+	inline size_t rows() const { return _rows; };
+	inline size_t cols() const { return _cols; };
+	inline size_t stride() const { return _stride; };
+	inline bool contiguous() const { return _stride == _cols || _rows <= 1; };
+	inline Scalar* data() const { return _data; };
+
+	inline Scalar& operator()(size_t i, size_t j) const { return _data[i * _stride + j]; };
+	inline Scalar* row_data(size_t i) const { return _data + i * _stride; };
+
+	// Slicing
+	inline BasicMatrixView row(size_t i) const { assert(i < _rows); return BasicMatrixView(row_data(i), 1, _cols, _stride); };
+	inline BasicMatrixView rows(size_t first, size_t count) const { assert(first + count <= _rows); return BasicMatrixView(row_data(first), count, _cols, _stride); };
+	inline BasicMatrixView block(size_t i, size_t j, size_t rows, size_t cols) const {
+		assert(i + rows <= _rows);
+		assert(j + cols <= _cols);
+		return BasicMatrixView(_data + i * _stride + j, rows, cols, _stride);
+	};
+};
+
+// Read-only view of a BasicMatrix<T>. As a function parameter it is a non-deduced context,
+// so T comes from the other arguments and matrices convert to it implicitly.
+template<typename T> struct ConstViewOf { using type = BasicMatrixView<const T>; };
+template<typename T> using ConstView = typename ConstViewOf<T>::type;
+
+#endif
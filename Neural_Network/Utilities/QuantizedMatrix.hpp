@@ -0,0 +1,92 @@
+#include "Matrix.hpp"
+
+
+#ifndef QUANTIZED_MATRIX_HPP
+#define QUANTIZED_MATRIX_HPP
+
+
+// ======== QUANTIZED MATRIX ======== //
+// Post-training int8 copy of a DenseBlock weight matrix (bias in its last row, as everywhere else).
+// Weights: symmetric, one scale per output channel, packed for KERNELS::QuantTable (groups of 4 rows,
+// interleaved per column, padded to depth x width). Inputs: one scale per layer, calibrated on sample
+// batches, quantized to [0, 127].
+// The bias row stays in float and is added after requantization.
+class QuantizedMatrix {
+private:
+	size_t _rows = 0;
+	size_t _cols = 0;
+	size_t _depth = 0;
+	size_t _width = 0;
+	float _input_scale = 1.f;
+
+	MEMORY::aligned_vector<int8_t> _matrix;
+	std::vector<float> _scales;
+	std::vector<float> _bias;
+
+public:
+	inline QuantizedMatrix() {};
+	template<typename T>
+	QuantizedMatrix(const BasicMatrix<T>& weights, float input_max);
+
+	size_t rows() const { return _rows; };
+	size_t cols() const { return _cols; };
+	size_t depth() const { return _depth; };
+	size_t width() const { return _width; };
+	float input_scale() const { return _input_scale; };
+
+	inline const int8_t* data() const { return _matrix.data(); };
+	inline float scale(size_t j) const { return _scales[j]; };
+	inline float bias(size_t j) const { return _bias[j]; };
+
+	// x -> round(x / input_scale) clamped to [0, 127]; the row is zero padded up to the depth
+	template<typename T>
+	inline void quantize_row(const T* x, uint8_t* x_q) const {
+		const float inv_scale = 1.f / _input_scale;
+		for (size_t k = 0; k < _rows - 1; k++) {
+			const float q = std::min(127.f, std::max(0.f, static_cast<float>(x[k]) * inv_scale));
+			x_q[k] = static_cast<uint8_t>(q + 0.5f);
+		}
+		std::fill(x_q + _rows - 1, x_q + _depth, uint8_t(0));
+	};
+
+	template<typename T>
+	BasicMatrix<T> dequantize() const;
+
+private:
+	inline size_t index(size_t k, size_t j) const { return (k / 4) * _width * 4 + j * 4 + k % 4; };
+};
+
+
+template<typename T>
+QuantizedMatrix::QuantizedMatrix(const BasicMatrix<T>& weights, float input_max)
+	: _rows(weights.rows()), _cols(weights.cols()), _depth((weights.rows() - 1 + 3) / 4 * 4), _width((weights.cols() + 15) / 16 * 16),
+	  _matrix(_depth * _width, 0), _scales(_cols), _bias(_cols) {
+
+	_input_scale = input_max > 0.f ? input_max / 127.f : 1.f;
+
+	for (size_t j = 0; j < _cols; j++) {
+		float max_abs = 0.f;
+		for (size_t k = 0; k < _rows - 1; k++)
+			max_abs = std::max(max_abs, std::abs(static_cast<float>(weights(k, j))));
+		_scales[j] = max_abs > 0.f ? max_abs / 127.f : 1.f;
+
+		for (size_t k = 0; k < _rows - 1; k++) {
+			const float q = std::nearbyint(static_cast<float>(weights(k, j)) / _scales[j]);
+			_matrix[index(k, j)] = static_cast<int8_t>(std::min(127.f, std::max(-127.f, q)));
+		}
+		_bias[j] = static_cast<float>(weights(_rows - 1, j));
+	}
+}
+
+template<typename T>
+BasicMatrix<T> QuantizedMatrix::dequantize() const {
+	BasicMatrix<T> weights(_rows, _cols);
+	for (size_t j = 0; j < _cols; j++) {
+		for (size_t k = 0; k < _rows - 1; k++)
+			weights(k, j) = _matrix[index(k, j)] * _scales[j];
+		weights(_rows - 1, j) = _bias[j];
+	}
+	return weights;
+}
+
+#endif
@@ -0,0 +1,94 @@
+#include "Matrix.hpp"
+#include "Kernels.hpp"
+
+
+#ifndef SPARSE_MATRIX_HPP
+#define SPARSE_MATRIX_HPP
+
+
+// ======== SPARSE MATRIX ======== //
+// Block-sparse copy of a pruned DenseBlock weight matrix (bias in its last row, as everywhere else).
+// Each weight row is cut into runs of KERNELS::sparse_block columns, and only the runs holding a non-zero
+// are stored, row after row (CSR over blocks). The last run of a row is zero padded. The bias row stays dense.
+template<typename Scalar>
+class BasicSparseMatrix {
+private:
+	size_t _rows = 0;
+	size_t _cols = 0;
+
+	std::vector<uint32_t> _row_start;
+	std::vector<uint32_t> _block_col;
+	MEMORY::aligned_vector<Scalar> _blocks;
+	MEMORY::aligned_vector<Scalar> _bias;
+
+public:
+	static constexpr size_t block = KERNELS::sparse_block;
+
+	inline BasicSparseMatrix() {};
+	explicit BasicSparseMatrix(const BasicMatrix<Scalar>& weights);
+
+	size_t rows() const { return _rows; };
+	size_t cols() const { return _cols; };
+	size_t blocks_per_row() const { return (_cols + block - 1) / block; };
+	size_t n_blocks() const { return _block_col.size(); };
+
+	inline const uint32_t* row_start() const { return _row_start.data(); };
+	inline const uint32_t* block_col() const { return _block_col.data(); };
+	inline const Scalar* blocks() const { return _blocks.data(); };
+	inline const Scalar* bias() const { return _bias.data(); };
+
+	BasicMatrix<Scalar> densify() const;
+
+	// Fraction of the blocks of the weight rows (bias excluded) that hold a non-zero
+	static double block_density(const BasicMatrix<Scalar>& weights);
+};
+
+using SparseMatrix = BasicSparseMatrix<real>;
+
+
+template<typename Scalar>
+BasicSparseMatrix<Scalar>::BasicSparseMatrix(const BasicMatrix<Scalar>& weights)
+	: _rows(weights.rows()), _cols(weights.cols()), _row_start(1, 0), _bias(weights.data() + (_rows - 1) * _cols, weights.data() + _rows * _cols) {
+
+	for (size_t p = 0; p < _rows - 1; p++) {
+		const Scalar* row = weights.data() + p * _cols;
+		for (size_t j0 = 0; j0 < _cols; j0 += block) {
+			const size_t width = std::min(block, _cols - j0);
+			if (std::all_of(row + j0, row + j0 + width, [](Scalar w) { return w == Scalar(0); }))
+				continue;
+			_block_col.push_back(static_cast<uint32_t>(j0 / block));
+			_blocks.insert(_blocks.end(), row + j0, row + j0 + width);
+			_blocks.insert(_blocks.end(), block - width, Scalar(0));
+		}
+		_row_start.push_back(static_cast<uint32_t>(_block_col.size()));
+	}
+}
+
+template<typename Scalar>
+BasicMatrix<Scalar> BasicSparseMatrix<Scalar>::densify() const {
+	BasicMatrix<Scalar> weights(_rows, _cols);
+	for (size_t p = 0; p < _rows - 1; p++)
+		for (uint32_t b = _row_start[p]; b < _row_start[p + 1]; b++) {
+			const size_t j0 = _block_col[b] * block;
+			for (size_t j = j0; j < std::min(j0 + block, _cols); j++)
+				weights(p, j) = _blocks[b * block + j - j0];
+		}
+	for (size_t j = 0; j < _cols; j++)
+		weights(_rows - 1, j) = _bias[j];
+	return weights;
+}
+
+template<typename Scalar>
+double BasicSparseMatrix<Scalar>::block_density(const BasicMatrix<Scalar>& weights) {
+	const size_t cols = weights.cols();
+	const size_t per_row = (cols + block - 1) / block;
+	size_t kept = 0;
+	for (size_t p = 0; p + 1 < weights.rows(); p++) {
+		const Scalar* row = weights.data() + p * cols;
+		for (size_t j0 = 0; j0 < cols; j0 += block)
+			kept += std::any_of(row + j0, row + std::min(j0 + block, cols), [](Scalar w) { return w != Scalar(0); });
+	}
+	return weights.rows() > 1 ? double(kept) / ((weights.rows() - 1) * per_row) : 1.0;
+}
+
+#endif
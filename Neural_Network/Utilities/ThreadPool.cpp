@@ -0,0 +1,158 @@
+#include "ThreadPool.hpp"
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
+
+
+namespace THREADS {
+
+	static inline void cpu_relax() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+		_mm_pause();
+#else
+		std::this_thread::yield();
+#endif
+	}
+
+
+	// ======== BARRIER ======== //
+	// The last thread in bumps the generation. Sleepers register before re-checking it under the mutex,
+	// and the releaser checks for sleepers after bumping it, so a wake-up can't be lost.
+	void Barrier::arrive_and_wait() {
+		const size_t generation = _generation.load();
+		if (_arrived.fetch_add(1) + 1 == _count) {
+			_arrived.store(0);
+			_generation.fetch_add(1);
+			if (_sleepers.load() > 0) {
+				std::lock_guard<std::mutex> lock(_mutex);
+				_cv.notify_all();
+			}
+			return;
+		}
+
+		for (size_t spin = 0; spin < spin_iterations; spin++) {
+			if (_generation.load(std::memory_order_acquire) != generation)
+				return;
+			cpu_relax();
+		}
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		_sleepers.fetch_add(1);
+		_cv.wait(lock, [&]() { return _generation.load() != generation; });
+		_sleepers.fetch_sub(1);
+	}
+
+
+	// ======== POOL ======== //
+	// Each parallel_for: start barrier (workers pick up the job), everyone drains the task counter, end barrier
+	class Pool {
+	private:
+		std::vector<std::thread> _workers;
+		Barrier _start;
+		Barrier _end;
+		bool _stop = false;
+
+		void (*_task)(const void*, size_t) = nullptr;
+		const void* _context = nullptr;
+		size_t _n_tasks = 0;
+		std::atomic<size_t> _next{ 0 };
+
+		void drain() {
+			for (size_t i = _next.fetch_add(1); i < _n_tasks; i = _next.fetch_add(1))
+				_task(_context, i);
+		}
+
+		void work();
+
+	public:
+		std::mutex owner;
+
+		explicit Pool(size_t n_threads) : _start(n_threads), _end(n_threads) {
+			for (size_t t = 1; t < n_threads; t++)
+				_workers.emplace_back(&Pool::work, this);
+		}
+
+		~Pool() {
+			_stop = true;
+			_start.arrive_and_wait();
+			for (std::thread& worker : _workers)
+				worker.join();
+		}
+
+		size_t size() const { return _workers.size() + 1; };
+
+		void run(size_t n_tasks, void (*task)(const void*, size_t), const void* context) {
+			_task = task;
+			_context = context;
+			_n_tasks = n_tasks;
+			_next.store(0);
+			_start.arrive_and_wait();
+			drain();
+			_end.arrive_and_wait();
+		}
+	};
+
+	// Set while a thread runs pool tasks, to serialize nested parallel_fors
+	static thread_local bool in_pool = false;
+
+	void Pool::work() {
+		in_pool = true;
+		while (true) {
+			_start.arrive_and_wait();
+			if (_stop)
+				return;
+			drain();
+			_end.arrive_and_wait();
+		}
+	}
+
+	static size_t default_threads() {
+		const char* name = std::getenv("FFNN_THREADS");
+		if (name && std::atoi(name) > 0)
+			return std::atoi(name);
+		return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	}
+
+	static std::unique_ptr<Pool>& pool() {
+		static std::unique_ptr<Pool> instance = std::make_unique<Pool>(default_threads());
+		return instance;
+	}
+
+	void set_threads(size_t n) {
+		if (n == 0)
+			n = default_threads();
+		if (n == pool()->size())
+			return;
+		pool().reset();
+		pool() = std::make_unique<Pool>(n);
+	}
+
+	size_t threads() {
+		return pool()->size();
+	}
+
+	void serial_thread() {
+		in_pool = true;
+	}
+
+	void run(size_t n_tasks, void (*task)(const void*, size_t), const void* context) {
+		Pool& p = *pool();
+		std::unique_lock<std::mutex> lock(p.owner, std::try_to_lock);
+		if (n_tasks <= 1 || p.size() == 1 || in_pool || !lock.owns_lock()) {
+			for (size_t i = 0; i < n_tasks; i++)
+				task(context, i);
+			return;
+		}
+
+		in_pool = true;
+		p.run(n_tasks, task, context);
+		in_pool = false;
+	}
+}
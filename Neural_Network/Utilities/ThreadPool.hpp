@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+
+// ======== THREAD POOL ======== //
+// Workers are started once (set_threads) and kept: a parallel_for only wakes them up.
+// The calling thread takes tasks too, so threads() counts it. Tasks are handed out one at a time
+// from a shared counter. A parallel_for issued from inside a task, or while another thread owns
+// the pool, runs serially on the calling thread.
+namespace THREADS {
+
+	// Spin-then-block barrier for a fixed number of threads. Waiters spin on the generation for
+	// spin_iterations before sleeping on a condition variable, so the back-to-back parallel sections
+	// of one training step (a few microseconds apart) never pay for a wake-up.
+	class Barrier {
+	private:
+		const size_t _count;
+		std::atomic<size_t> _arrived{ 0 };
+		std::atomic<size_t> _generation{ 0 };
+		std::atomic<size_t> _sleepers{ 0 };
+		std::mutex _mutex;
+		std::condition_variable _cv;
+
+	public:
+		static constexpr size_t spin_iterations = 4096;
+
+		explicit Barrier(size_t count) : _count(count) {};
+		void arrive_and_wait();
+	};
+
+	// 0: FFNN_THREADS if set in the environment, otherwise one per hardware thread. The pool starts with that size.
+	// Not meant to be called while a parallel_for runs.
+	void set_threads(size_t n);
+	size_t threads();
+
+	// Every parallel_for issued by the calling thread runs serially from now on: for helper threads,
+	// which would otherwise take the pool from the thread driving the GEMMs
+	void serial_thread();
+
+	// Runs task(i) for every i in [0, n_tasks), on the pool, and returns once all of them are done
+	void run(size_t n_tasks, void (*task)(const void* context, size_t i), const void* context);
+
+	template<typename F>
+	inline void parallel_for(size_t n_tasks, const F& task) {
+		if (n_tasks == 1) {
+			task(size_t(0));
+			return;
+		}
+		run(n_tasks, [](const void* context, size_t i) { (*static_cast<const F*>(context))(i); }, &task);
+	};
+
+	// range(begin, end) over [0, n) cut into at most threads() chunks of at least grain elements,
+	// with inner bounds on multiples of align (e.g. 16 floats to keep chunks on cache lines)
+	template<typename F>
+	inline void parallel_ranges(size_t n, size_t grain, const F& range, size_t align = 1) {
+		const size_t chunks = std::min(threads(), std::max<size_t>(n / std::max<size_t>(grain, 1), 1));
+		parallel_for(chunks, [&](size_t c) {
+			const size_t begin = c == 0 ? 0 : n * c / chunks / align * align;
+			const size_t end = c + 1 == chunks ? n : n * (c + 1) / chunks / align * align;
+			if (begin < end)
+				range(begin, end);
+		});
+	};
+}
+
+#endif
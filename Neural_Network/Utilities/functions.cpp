@@ -13,33 +13,6 @@ int random_bit() {
 	return dist(get_rng());
 }
 
-d_matrix hotOne(const d_vector& y, const int& nElements) {
-
-	d_matrix C(y.size(), d_vector(nElements, 0));
-
-	for (int i = 0; i < y.size(); i++)
-		C[i][y[i]] = 1;
-
-	return C;
-}
-
-// Cross-entropy loss computation
-double CELossFunction(const Matrix& y_pred, const Matrix& y_true) {
-	double mean_loss = 0.0;
-
-	for (int i = 0; i < y_pred.rows(); i++)
-		for (int j = 0; j < y_pred.cols(); j++)
-			if (y_true(i, j) == 1.0) {
-				mean_loss += -log(std::max(y_pred(i, j), 1e-9));
-				break;
-			}
-
-	mean_loss /= y_pred.rows();
-
-	return mean_loss;
-}
-
-
 // Write output data to plot with python
 void writeFile(const d_vector& train_acc, const d_vector& val_acc, const d_vector& loss, int nb_epochs, const std::string& filename) {
 	std::ofstream outFile(filename);
@@ -54,4 +27,22 @@ void writeFile(const d_vector& train_acc, const d_vector& val_acc, const d_vecto
 	}
 
 	outFile.close();
-}
\ No newline at end of file
+}
+
+// Forward: X (batch x in) * packed W. dW = X^T * dZ. dZ of the layer below = dZ * W^T (not for the input layer).
+std::vector<GEMM::Shape> gemm_shapes(const hyperparameters& hyper) {
+	std::vector<size_t> sizes = { size_t(hyper.input_dim) };
+	for (int size : hyper.hidden_layer_sizes)
+		sizes.push_back(size);
+	sizes.push_back(hyper.output_dim);
+
+	const size_t batch = hyper.mini_batch_size;
+	std::vector<GEMM::Shape> shapes;
+	for (size_t l = 0; l + 1 < sizes.size(); l++) {
+		shapes.push_back({ batch, sizes[l + 1], sizes[l], false, false, true });
+		shapes.push_back({ sizes[l], sizes[l + 1], batch, true, false, false });
+		if (l > 0)
+			shapes.push_back({ batch, sizes[l], sizes[l + 1], false, true, false });
+	}
+	return shapes;
+}
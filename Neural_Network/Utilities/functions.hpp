@@ -1,13 +1,22 @@
 #include "Matrix.hpp"
+#include "HalfMatrix.hpp"
+#include "QuantizedMatrix.hpp"
+#include "SparseMatrix.hpp"
+#include "Kernels.hpp"
+#include "Backend.hpp"
+#include "ThreadPool.hpp"
 
 #ifndef FUNCTIONS_H
 #define FUNCTIONS_H
 
+// Where the Adam moments of Hogwild training live (see Hogwild), Off for synchronous training
+enum class HogwildMoments { Off, PerThread, Shared };
+
 // Hyperparameters
 struct hyperparameters {
 	int input_dim;
 	int output_dim;
-	d_vector hidden_layer_sizes;
+	i_vector hidden_layer_sizes;
 	double learning_rate;
 	double dropout_rate;
 	int max_epochs;
@@ -16,18 +25,31 @@ struct hyperparameters {
 	int n_val_samples;
 	bool early_stopping;
 	int patience;
+	double pruning_sparsity; // Fraction of weight blocks cut after training, 0 to keep the model dense
+	int pruning_epochs; // Fine-tuning epochs after pruning
+	int n_threads = 0; // Threads of the GEMM / element-wise pool, 0 for FFNN_THREADS or else one per hardware thread
+	int n_replicas = 1; // Data-parallel replicas of the model sharing each training step (see DataParallel)
+	int batches_per_step = 1; // Mini-batches per training step, split between the replicas
+	HogwildMoments hogwild = HogwildMoments::Off; // Asynchronous lock-free training on every pool thread
+	bool pipelined = true; // Adam updates overlapped with backprop and the next forward, layer by layer (see Pipeline)
 };
 
 std::mt19937_64& get_rng();
 double random(const double& min, const double& max); // Random function
 int random_bit(); // Random bit between 0 and 1
 
-d_matrix hotOne(const d_vector& y, const int& nElements);
-double CELossFunction(const Matrix& y_pred, const Matrix& y_true); // Return the cross-entropy loss.
+// Mean cross-entropy loss and number of correct predictions of one batch
+struct LossStats {
+	double loss = 0.0;
+	int correct = 0;
+};
 
 // Utility function used in TrainerClassifier.h
 void writeFile(const d_vector& train_acc, const d_vector& test_acc, const d_vector& loss, int nb_epochs, const std::string& filename);
 
+// The GEMMs of one training step (forward, dW, dZ of every layer), for GEMM::autotune
+std::vector<GEMM::Shape> gemm_shapes(const hyperparameters& hyper);
+
 
 namespace ACTIVATION {
 
@@ -35,116 +57,373 @@ namespace ACTIVATION {
 		return (inputs > 0.0 ? 1.0 : 0);
 	};
 
-	inline Matrix ReLU_activation(const Matrix& inputs) {
+	// output may be inputs
+	template<typename T>
+	inline void ReLU_activation_into(BasicMatrix<T>& output, ConstView<T> inputs) {
 
-		Matrix output(inputs.rows(), inputs.cols());
+		if (output.data() != inputs.data())
+			output.resize(inputs.rows(), inputs.cols());
 		for (size_t i = 0; i < inputs.rows(); i++)
 			for (size_t j = 0; j < inputs.cols(); j++)
-				output(i, j) = std::max(0.0, inputs(i, j));
+				output(i, j) = std::max(T(0), inputs(i, j));
+	};
+
+	template<typename T>
+	inline BasicMatrix<T> ReLU_activation(const BasicMatrix<T>& inputs) {
+
+		BasicMatrix<T> output;
+		ReLU_activation_into(output, inputs);
 		return output;
 	};
 
-	inline Matrix softmax_activation(const Matrix& inputs) {
+	// Row-wise softmax in place: each row is read and written while it sits in L1, with a SIMD polynomial exp
+	template<typename T>
+	inline void softmax_inplace(BasicMatrix<T>& inputs) {
 
-		d_vector maxs(inputs.rows());
-		for (size_t i = 0; i < inputs.rows(); i++) {
-			maxs[i] = inputs(i, 0);
-			for (size_t j = 0; j < inputs.cols(); j++)
-				if (inputs(i, j) > maxs[i])
-					maxs[i] = inputs(i, j);
-		}
+		const size_t cols = inputs.cols();
+		const BACKEND::Backend<T>& backend = BACKEND::get<T>();
+		for (size_t i = 0; i < inputs.rows(); i++)
+			backend.softmax_row(cols, inputs.data() + i * cols, inputs.data() + i * cols, nullptr, nullptr);
+	};
 
-		Matrix expvalues = inputs;
-		d_vector sum_of_exps(inputs.rows(), 0);
-		for (size_t i = 0; i < inputs.rows(); i++) {
-			for (size_t j = 0; j < inputs.cols(); j++) {
-				expvalues(i, j) = std::exp(inputs(i, j) - maxs[i]);
-				sum_of_exps[i] += expvalues(i, j);
-			}
+	template<typename T>
+	inline void softmax_activation_into(BasicMatrix<T>& output, ConstView<T> inputs) {
+
+		if (output.data() != inputs.data()) {
+			output.resize(inputs.rows(), inputs.cols());
+			for (size_t i = 0; i < inputs.rows(); i++)
+				std::copy(inputs.row_data(i), inputs.row_data(i) + inputs.cols(), output.data() + i * inputs.cols());
 		}
+		softmax_inplace(output);
+	};
 
-		Matrix output(inputs.rows(), inputs.cols());
-		for (size_t i = 0; i < inputs.rows(); i++)
-			for (size_t j = 0; j < inputs.cols(); j++)
-				output(i, j) = expvalues(i, j) / sum_of_exps[i];
+	template<typename T>
+	inline BasicMatrix<T> softmax_activation(const BasicMatrix<T>& inputs) {
 
+		BasicMatrix<T> output;
+		softmax_activation_into(output, inputs);
 		return output;
 	};
 }
 
 
+namespace LOSS {
+
+	// Fused softmax + cross-entropy on the output layer, one pass per row of logits with integer labels:
+	// gradient = softmax(logits) - onehot(label), loss = max + log(sum exp(logit - max)) - logit[label], correct if argmax == label.
+	// The logs of the row sums are taken together at the end, a vector at a time.
+	// labels holds one entry per row. gradient may alias (contiguous) logits.
+	template<typename T>
+	inline LossStats softmax_cross_entropy(BasicMatrix<T>& gradient, ConstView<T> logits, const int* labels) {
+		const size_t rows = logits.rows();
+		const size_t cols = logits.cols();
+
+		if (gradient.data() != logits.data())
+			gradient.resize(rows, cols);
+		else
+			assert(logits.contiguous());
+
+		thread_local std::vector<T> sum_of_exps;
+		sum_of_exps.resize(rows);
+
+		LossStats stats;
+		const BACKEND::Backend<T>& backend = BACKEND::get<T>();
+		for (size_t i = 0; i < rows; i++) {
+			const T* z = logits.row_data(i);
+			T* dz = gradient.data() + i * cols;
+			const int label = labels[i];
+
+			T max;
+			size_t max_index;
+			const T label_logit = z[label];
+			sum_of_exps[i] = backend.softmax_row(cols, z, dz, &max, &max_index);
+			dz[label] -= T(1);
+
+			stats.loss += static_cast<double>(max) - label_logit;
+			stats.correct += (static_cast<int>(max_index) == label);
+		}
+
+		backend.log_row(rows, sum_of_exps.data(), sum_of_exps.data());
+		stats.loss += backend.sum(rows, sum_of_exps.data());
+		if (rows)
+			stats.loss /= rows;
+
+		return stats;
+	};
+
+	// Number of rows whose argmax is the label (softmax is monotonic, so logits or probabilities both work)
+	template<typename T>
+	inline int count_correct(BasicMatrixView<const T> output, const int* labels) {
+		const BACKEND::Backend<T>& backend = BACKEND::get<T>();
+
+		int correct = 0;
+		for (size_t i = 0; i < output.rows(); i++)
+			correct += (static_cast<int>(backend.argmax(output.cols(), output.row_data(i))) == labels[i]);
+		return correct;
+	};
+	template<typename T>
+	inline int count_correct(const BasicMatrix<T>& output, const int* labels) { return count_correct(output.view(), labels); };
+}
+
+
 namespace MATRIX_OPERATION {
 
-	inline void compute_Y_from_input(Matrix& output, const Matrix& input, const Matrix& weights) {
+	// Y = X * W[0:n-1] + bias, with the bias (and the ReLU if relu) applied in the GEMM epilogue. A single row goes through gemv.
+	template<typename T>
+	inline void compute_Y_from_input(BasicMatrix<T>& output, ConstView<T> input, const BasicMatrix<T>& weights, bool relu = false) {
 		size_t output_rows = input.rows();
 		size_t output_cols = weights.cols();
 		size_t middle_dim = weights.rows();
 		assert(middle_dim == input.cols() + 1);
 
-		output = Matrix(output_rows, output_cols);
-		for (size_t i = 0; i < output_rows; i++) {
-			size_t row_offset = i * middle_dim;
-			for (size_t k = 0; k < middle_dim - 1; k++) {
-				double input_ik = input(i, k);
-				for (size_t j = 0; j < output_cols; j++)
-					output(i, j) += input_ik * weights(k, j);
-			}
-			size_t k = middle_dim - 1;
-			double input_ik = input(i, k);
-			for (size_t j = 0; j < output_cols; j++)
-				output(i, j) += weights(k, j);
+		output.resize(output_rows, output_cols);
+		const BACKEND::Backend<T>& backend = BACKEND::get<T>();
+		GEMM::Epilogue<T> epilogue{ weights.data() + (middle_dim - 1) * output_cols, relu };
+		if (output_rows == 1)
+			backend.gemv(middle_dim - 1, output_cols, input.data(), weights.data(), output_cols, output.data(), false, epilogue);
+		else
+			backend.gemm(false, false, output_rows, output_cols, middle_dim - 1,
+						 input.data(), input.stride(),
+						 weights.data(), output_cols,
+						 output.data(), output_cols, false, epilogue);
+	};
+
+	// Same with the first n rows of W pre-packed into GEMM panels (bias still read from W)
+	template<typename T>
+	inline void compute_Y_from_input(BasicMatrix<T>& output, ConstView<T> input, const BasicMatrix<T>& weights, const GEMM::PackedB<T>& packed, bool relu = false) {
+		size_t output_rows = input.rows();
+		size_t output_cols = weights.cols();
+		size_t middle_dim = weights.rows();
+		assert(middle_dim == input.cols() + 1);
+		assert(packed.rows() == middle_dim - 1 && packed.cols() == output_cols);
+
+		output.resize(output_rows, output_cols);
+		const BACKEND::Backend<T>& backend = BACKEND::get<T>();
+		assert(backend.gemm_packed);
+		GEMM::Epilogue<T> epilogue{ weights.data() + (middle_dim - 1) * output_cols, relu };
+		backend.gemm_packed(output_rows, input.data(), input.stride(), packed, output.data(), output_cols, false, epilogue);
+	};
+
+	// Inputs at most this dense (fraction of non-zeros) go through the sparse path below.
+	// Measured crossover on the 784 x 256 layer at batch 32 and 256: 15-17% non-zeros.
+	constexpr double sparse_density_threshold = 0.15;
+
+	template<typename T>
+	inline double density(BasicMatrixView<const T> input) {
+		size_t non_zeros = 0;
+		for (size_t i = 0; i < input.rows(); i++) {
+			const T* row = input.row_data(i);
+			for (size_t j = 0; j < input.cols(); j++)
+				non_zeros += row[j] != T(0);
 		}
+		return input.rows() * input.cols() != 0 ? double(non_zeros) / (input.rows() * input.cols()) : 1.0;
+	};
+
+	// The dense GEMM computes whole MR-row tiles, so a small batch also pays for its padding rows
+	// and the sparse path wins at proportionally higher densities. At batch 1 the bound is 0.15 x MR:
+	// with 8- or 12-row tiles (AVX-512 and the tuned AVX2 tiles) every row goes sparse, dense ones included.
+	template<typename T>
+	inline bool prefer_sparse(BasicMatrixView<const T> input) {
+		const size_t MR = KERNELS::get<T>().tiles[GEMM::blocking<T>().tile].mr;
+		const size_t rows = std::max<size_t>(input.rows(), 1);
+		const double threshold = sparse_density_threshold * ((rows + MR - 1) / MR * MR) / rows;
+		return threshold >= 1.0 || density(input) <= threshold;
+	};
+
+	// Same as the dense Y = X * W + bias, for mostly-zero X (e.g. MNIST pixels): each row of X is compressed
+	// to its non-zeros and only the matching rows of W are read
+	template<typename T>
+	inline void compute_Y_from_sparse_input(BasicMatrix<T>& output, ConstView<T> input, const BasicMatrix<T>& weights, bool relu = false) {
+		size_t output_rows = input.rows();
+		size_t output_cols = weights.cols();
+		size_t middle_dim = weights.rows();
+		assert(middle_dim == input.cols() + 1);
+
+		output.resize(output_rows, output_cols);
+		const T* bias = weights.data() + (middle_dim - 1) * output_cols;
+		const KERNELS::Table<T>& kernels = KERNELS::get<T>();
+		THREADS::parallel_ranges(output_rows, 1, [&](size_t begin, size_t end) {
+			thread_local std::vector<T> values;
+			thread_local std::vector<uint32_t> index;
+			values.resize(input.cols());
+			index.resize(input.cols());
+
+			for (size_t i = begin; i < end; i++) {
+				const T* row = input.row_data(i);
+				size_t nnz = 0;
+				for (size_t k = 0; k < input.cols(); k++)
+					if (row[k] != T(0)) {
+						values[nnz] = row[k];
+						index[nnz++] = static_cast<uint32_t>(k);
+					}
+				kernels.sparse_row(nnz, values.data(), index.data(), weights.data(), output_cols, output_cols, output.data() + i * output_cols, bias, relu);
+			}
+		});
+	};
+
+	// Same with bf16 / fp16 weights: widened while packing, accumulated in T
+	template<typename T>
+	inline void compute_Y_from_input(BasicMatrix<T>& output, ConstView<T> input, const HalfMatrix& weights, bool relu = false) {
+		size_t output_rows = input.rows();
+		size_t output_cols = weights.cols();
+		size_t middle_dim = weights.rows();
+		assert(middle_dim == input.cols() + 1);
+
+		thread_local std::vector<T> bias;
+		bias.resize(output_cols);
+		for (size_t j = 0; j < output_cols; j++)
+			bias[j] = weights(middle_dim - 1, j);
+
+		output.resize(output_rows, output_cols);
+		GEMM::Epilogue<T> epilogue{ bias.data(), relu };
+		GEMM::gemm(output_rows, output_cols, middle_dim - 1,
+				   input.data(), input.stride(),
+				   weights.data(), output_cols, weights.format(),
+				   output.data(), output_cols, false, epilogue);
+	};
+
+	// Same with int8 weights: inputs quantized to uint8, int8 x uint8 -> int32 products,
+	// then requantized to T with the per-channel scales and the float bias (and the ReLU if relu)
+	template<typename T>
+	inline void compute_Y_from_input(BasicMatrix<T>& output, ConstView<T> input, const QuantizedMatrix& weights, bool relu = false) {
+		size_t output_rows = input.rows();
+		size_t output_cols = weights.cols();
+		size_t depth = weights.depth();
+		size_t width = weights.width();
+		assert(weights.rows() == input.cols() + 1);
+
+		thread_local MEMORY::aligned_vector<uint8_t> input_q;
+		thread_local MEMORY::aligned_vector<int32_t> accumulator;
+		input_q.resize(output_rows * depth);
+		accumulator.resize(output_rows * width);
+
+		for (size_t i = 0; i < output_rows; i++)
+			weights.quantize_row(input.row_data(i), input_q.data() + i * depth);
+
+		KERNELS::get_quant().gemm_u8s8(output_rows, width, depth, input_q.data(), weights.data(), accumulator.data());
+
+		output.resize(output_rows, output_cols);
+		const float input_scale = weights.input_scale();
+		for (size_t i = 0; i < output_rows; i++)
+			for (size_t j = 0; j < output_cols; j++) {
+				const T y = accumulator[i * width + j] * (input_scale * weights.scale(j)) + weights.bias(j);
+				output(i, j) = relu ? std::max(y, T(0)) : y;
+			}
+	};
+
+	// Same with block-sparse (pruned) weights: one row of X at a time, zero inputs and pruned blocks skipped
+	template<typename T>
+	inline void compute_Y_from_input(BasicMatrix<T>& output, ConstView<T> input, const BasicSparseMatrix<T>& weights, bool relu = false) {
+		size_t output_rows = input.rows();
+		size_t output_cols = weights.cols();
+		assert(weights.rows() == input.cols() + 1);
+
+		thread_local MEMORY::aligned_vector<T> accumulator;
+		accumulator.resize(weights.blocks_per_row() * weights.block);
+
+		output.resize(output_rows, output_cols);
+		const KERNELS::Table<T>& kernels = KERNELS::get<T>();
+		for (size_t i = 0; i < output_rows; i++)
+			kernels.block_sparse_row(input.cols(), output_cols, input.row_data(i), weights.row_start(), weights.block_col(), weights.blocks(),
+									 accumulator.data(), output.data() + i * output_cols, weights.bias(), relu);
 	};
 
-	inline void compute_dZ_from_next(Matrix& output, const Matrix& input, const Matrix& weights, const Matrix& preactivation) {
+	// activation is the ReLU output Z of the current layer: Z > 0 exactly where Y > 0, so it doubles as the ReLU' mask
+	template<typename T>
+	inline void compute_dZ_from_next(BasicMatrix<T>& output, ConstView<T> input, const BasicMatrix<T>& weights, ConstView<T> activation) {
 		const size_t batch = input.rows();
 		const size_t next_cols = input.cols();
 		const size_t weights_rows = weights.rows();
 		const size_t cur_cols = weights_rows - 1;
 
 		assert(next_cols == weights.cols());
-		assert(preactivation.rows() == batch);
-		assert(preactivation.cols() == cur_cols);
-
-		output = Matrix(batch, cur_cols);
-		for (size_t i = 0; i < batch; ++i) {
-			const size_t row_offset_dZ = i * next_cols;
-			const size_t row_offset_Y = i * cur_cols;
-			for (size_t j = 0; j < cur_cols; ++j) {
-				double sum = 0.0;
-				for (size_t k = 0; k < next_cols; ++k)
-					sum += input(row_offset_dZ + k) * weights(j, k);
-				double deriv = ACTIVATION::deriv_ReLU(preactivation(row_offset_Y + j));
-				output(i, j) = sum * deriv;
-			}
-		}
+		assert(activation.rows() == batch);
+		assert(activation.cols() == cur_cols);
+
+		// dZ = (dZ_next * W[0:n-1]^T) .* ReLU'(Y), the first n rows of W being read transposed by the GEMM
+		output.resize(batch, cur_cols);
+		const BACKEND::Backend<T>& backend = BACKEND::get<T>();
+		backend.gemm(false, true, batch, cur_cols, next_cols,
+					 input.data(), input.stride(),
+					 weights.data(), next_cols,
+					 output.data(), cur_cols, false, {});
+
+		if (activation.contiguous())
+			backend.relu_mask(batch * cur_cols, output.data(), activation.data());
+		else
+			for (size_t i = 0; i < batch; i++)
+				backend.relu_mask(cur_cols, output.data() + i * cur_cols, activation.row_data(i));
 	};
 
-	inline void compute_dW_from_input(Matrix& output, const Matrix& input, const Matrix& dZ) {
+	template<typename T>
+	inline void compute_dW_from_input(BasicMatrix<T>& output, ConstView<T> input, ConstView<T> dZ) {
 		const size_t batch = input.rows();
 		const size_t output_rows = input.cols() + 1;
 		const size_t output_cols = dZ.cols();
 
 		assert(batch == dZ.rows());
 
-		output = Matrix(output_rows, output_cols);
-		for (size_t i = 0; i < batch; ++i) {
-			const size_t row_offset_input = i * (output_rows - 1);
-			const size_t row_offset_dZ = i * output_cols;
+		// dW[0:n-1] = X^T * dZ (X read transposed by the GEMM), and the bias row is the column sum of dZ
+		output.resize(output_rows, output_cols);
+		const BACKEND::Backend<T>& backend = BACKEND::get<T>();
+		backend.gemm(true, false, output_rows - 1, output_cols, batch,
+					 input.data(), input.stride(),
+					 dZ.data(), dZ.stride(),
+					 output.data(), output_cols, false, {});
+
+		T* bias_row = output.data() + (output_rows - 1) * output_cols;
+		std::fill(bias_row, bias_row + output_cols, T(0));
+		for (size_t i = 0; i < batch; ++i)
+			backend.axpy(output_cols, T(1), dZ.row_data(i), bias_row);
+	};
+}
 
-			for (size_t j = 0; j < output_rows - 1; ++j) {
-				const double input_ij = input(row_offset_input + j);
-				for (size_t k = 0; k < output_cols; ++k)
-					output(j, k) += input_ij * dZ(row_offset_dZ + k);
-			}
-			for (size_t k = 0; k < output_cols; ++k)
-				output(output_rows - 1, k) += dZ(row_offset_dZ + k);
+
+namespace PRUNING {
+
+	// Magnitude pruning mask (1 = kept, 0 = pruned) of a weight matrix, in the block shape of BasicSparseMatrix:
+	// the runs of KERNELS::sparse_block columns of the weight rows with the smallest L1 norm are cut until
+	// the sparsity target (fraction of pruned blocks) is met. The bias row is always kept.
+	template<typename T>
+	inline void magnitude_mask_into(BasicMatrix<T>& mask, const BasicMatrix<T>& weights, double sparsity) {
+		constexpr size_t block = KERNELS::sparse_block;
+		const size_t rows = weights.rows();
+		const size_t cols = weights.cols();
+		const size_t per_row = (cols + block - 1) / block;
+
+		std::vector<T> norms((rows - 1) * per_row, T(0));
+		for (size_t p = 0; p < rows - 1; p++)
+			for (size_t j = 0; j < cols; j++)
+				norms[p * per_row + j / block] += std::abs(weights(p, j));
+
+		// Blocks strictly below the n_pruned-th smallest norm go, ties are resolved in row order
+		const size_t n_pruned = std::min(norms.size(), static_cast<size_t>(sparsity * norms.size() + 0.5));
+		std::vector<T> sorted = norms;
+		T cutoff = T(0);
+		if (n_pruned > 0) {
+			std::nth_element(sorted.begin(), sorted.begin() + (n_pruned - 1), sorted.end());
+			cutoff = sorted[n_pruned - 1];
 		}
+		size_t ties = n_pruned - std::count_if(norms.begin(), norms.end(), [cutoff](T n) { return n < cutoff; });
+
+		mask.resize(rows, cols);
+		for (size_t p = 0; p < rows - 1; p++)
+			for (size_t b = 0; b < per_row; b++) {
+				const T norm = norms[p * per_row + b];
+				bool pruned = n_pruned > 0 && norm < cutoff;
+				if (n_pruned > 0 && norm == cutoff && ties > 0) {
+					pruned = true;
+					ties--;
+				}
+				for (size_t j = b * block; j < std::min((b + 1) * block, cols); j++)
+					mask(p, j) = pruned ? T(0) : T(1);
+			}
+		for (size_t j = 0; j < cols; j++)
+			mask(rows - 1, j) = T(1);
 	};
 }
 
 
-
 // ===== PRINT FUNCTIONS =====
 // Multiple print
 template<typename... Args>
@@ -157,7 +436,8 @@ typename std::enable_if<!std::is_same<T, Matrix>::value, void>::type
 inline print(const T& arg) { std::cout << arg << std::endl; }
 
 // Matrix print
-inline void print(const Matrix& A) {
+template<typename T>
+inline void print(const BasicMatrix<T>& A) {
 	const size_t rows = A.rows();
 	const size_t cols = A.cols();
 
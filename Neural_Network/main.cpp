@@ -1,5 +1,6 @@
 ﻿#include <SFML/Graphics.hpp>
 #include "FFNN/FFNN.hpp"
+#include "FFNN/StaticFFNN.hpp"
 #include "Classifier/TrainerClassifier.hpp"
 #include "Classifier/Scope.hpp"
 #include "Dataset/Dataset.hpp"
@@ -15,19 +16,75 @@ hyperparameters hyper = {
     max_epochs : 50,
     n_train_samples : 10000,
     mini_batch_size : 32,
-    n_val_samples : 1000,
+    n_val_samples : 10000,
 
     early_stopping : true,
-    patience : 10
+    patience : 10,
+
+    pruning_sparsity : 0.0,
+    pruning_epochs : 10,
+
+    n_threads : 0,
+    n_replicas : 1,
+    batches_per_step : 1,
+    hogwild : HogwildMoments::Off,
+    pipelined : true
 };
 
 int main() {
+    THREADS::set_threads(hyper.n_threads);
+    // Block sizes for this CPU: tuned on the first run, read back from the cache file afterwards
+    GEMM::Blocking blocking = GEMM::autotune<real>(gemm_shapes(hyper), "executable/gemm_tuning.txt");
+    const auto& tile = KERNELS::get<real>().tiles[blocking.tile];
+    print("GEMM blocking: ", tile.mr, "x", tile.nr, " tile (unroll ", tile.unroll, "), MC ", blocking.mc, ", KC ", blocking.kc, ", NC ", blocking.nc);
+
     FFNN model(hyper);
+    print("SIMD kernels: ", KERNELS::get<real>().name, ", backend: ", BACKEND::get<real>().name, ", threads: ", THREADS::threads());
 
     bool learning = false;
-    print("Train ? (y/n)"); char a; std::cin >> a;
+    print("Train ? (y/n, e to evaluate the saved weights on the test set, s for the training scaling report, h for Hogwild vs synchronous training)"); char a; std::cin >> a;
     if (a == 'y') learning = true;
 
+    // Samples/s of data-parallel training from 1 to 64 cores, 8 mini-batches per step so that every core gets rows
+    if (a == 's') {
+        hyperparameters scaling = hyper;
+        scaling.batches_per_step = 8;
+        TrainerClassifier benchmark(model, scaling);
+        Dataset train = DataLoader(scaling, "train");
+        benchmark.scaling(train, { 1, 2, 4, 8, 16, 32, 64 }, 20);
+        return 0;
+    }
+
+    // Loss and samples/s of synchronous and Hogwild training, 5 epochs each from the same initial weights
+    if (a == 'h') {
+        TrainerClassifier benchmark(model, hyper);
+        Dataset train = DataLoader(hyper, "train");
+        Dataset validation = DataLoader(hyper, "validation");
+        benchmark.compare_hogwild(train, validation, 5);
+        return 0;
+    }
+
+    // Accuracy report of the saved weights stored in full, bf16, fp16 and int8 precision
+    if (a == 'e') {
+        TrainerClassifier evaluator(model, hyper);
+        Dataset test = DataLoader(hyper, "test");
+
+        const std::pair<WeightFormat, const char*> formats[] = {
+            { WeightFormat::Full, "full" }, { WeightFormat::BF16, "bf16" }, { WeightFormat::FP16, "fp16" } };
+        for (auto& [format, name] : formats) {
+            model.loadWeights("executable/model_weights.txt");
+            model.setWeightFormat(format);
+            print("Test accuracy (", name, " weights) = ", evaluator.evaluate(test), " %");
+        }
+
+        // int8: calibrated on a few training batches, softmax layer kept in float
+        Dataset calibration = DataLoader(hyper, "train");
+        model.loadWeights("executable/model_weights.txt");
+        model.quantize(calibration.x(0, std::min<size_t>(10, calibration.n_batches)));
+        print("Test accuracy (int8 weights, ", KERNELS::get_quant().name, ") = ", evaluator.evaluate(test), " %");
+        return 0;
+    }
+
     bool store = true;
 
     if(learning) {
@@ -44,6 +101,19 @@ int main() {
         print("Data has been successfully imported");
 
         trainer.run(store);
+
+        // Magnitude pruning, fine-tuning with the pruned weights held at zero, then block-sparse storage
+        if (hyper.pruning_sparsity > 0) {
+            scope.prune(model, hyper.pruning_sparsity);
+            hyperparameters finetuning = hyper;
+            finetuning.max_epochs = hyper.pruning_epochs;
+            TrainerClassifier finetuner(model, finetuning);
+            finetuner.set_scope(scope);
+            finetuner.set_data(train, validation);
+            print("Pruned ", 100 * hyper.pruning_sparsity, " % of the weight blocks, fine-tuning");
+            finetuner.run(false);
+            model.sparsify();
+        }
         model.saveWeights("executable/model_weights.txt");
         print("Weights saved !");
 
@@ -55,6 +125,11 @@ int main() {
     }
 
 
+    // Compile-time copy of the network for the canvas guesses, its sizes must match hyper's
+    static StaticFFNN<28*28, 256, 128, 10> canvas_model;
+    canvas_model.loadWeights("executable/model_weights.txt");
+
+
     // Window init
     sf::RenderWindow window(sf::VideoMode({ 800, 800 }), "Deep Learning with Adam Optimizer");
     window.setFramerateLimit(100);
@@ -113,8 +188,7 @@ int main() {
                             for (size_t j = 0; j < 28; j++)
                                 pixels(0, j * 28 + i) = 1.f - static_cast<int>(canvas.getTexture().copyToImage().getPixel({ i, j }).g) / 255.f;
 
-                        model.forward(pixels);
-                        print("The number you've drawn is ", model.getOutput().getMaxIndex(), " !!!");
+                        print("The number you've drawn is ", canvas_model.predict(pixels.data()), " !!!");
                     }
                     firstPress = false;
                 }